@@ -363,6 +363,14 @@ Instruction logicalShiftLeftImmediate(Register rd, Register rm, uint8_t imm)
     return shift(0b00000, 11, 5) | shift(imm, 6, 5) | shiftReg(rm, 3, 3) | shiftReg(rd, 0, 3);
 }
 
+Instruction logicalShiftRightImmediate(Register rd, Register rm, uint8_t imm)
+{
+    assertLowRegister(rd);
+    assertLowRegister(rm);
+
+    return shift(0b00001, 11, 5) | shift(imm, 6, 5) | shiftReg(rm, 3, 3) | shiftReg(rd, 0, 3);
+}
+
 Instruction leftShiftLogicalRegister(Register rd, Register rs)
 {
     return arithmeticOperation(rd, rs, ARM::ArithmeticLogicOperation::lsl2);
@@ -459,6 +459,15 @@ Instruction loadSignedHalfWordWithRegisterOffset(Register rd, Register rn, Regis
  */
 Instruction logicalShiftLeftImmediate(Register rd, Register rm, uint8_t imm);
 
+/**
+ * LSR (1) A7-68
+ * |rd| = |rm| >> imm, filling with zeroes
+ * |rm| and |rd| must be low registers
+ * 0 < |imm| < 32
+ * 1 cycle
+ */
+Instruction logicalShiftRightImmediate(Register rd, Register rm, uint8_t imm);
+
 /**
  * LSL (2) A7-66
  * |rd| = |rd| << |rs|
@@ -3,12 +3,15 @@
 #include "Decoder.h"
 #include "Transfer/Deserialiser.h"
 #include "Transfer/Serialiser.h"
+#include <algorithm>
+#include <cstdio>
 
 namespace ARM {
 
-void Functor::reserve(size_t capacity)
+void Functor::truncate(size_t length)
 {
-    m_buffer.reserve(capacity);
+    m_buffer.resize(length - m_sealedLength);
+    m_hasChanges = true;
 }
 
 void Functor::add(Instruction instruction)
@@ -37,8 +40,19 @@ void Functor::commit()
 
 Instruction* Functor::buffer() const
 {
-    // Cast necessary because there are two overloads of data(), and the const one gets called here
-    return (Instruction*)m_buffer.data();
+    return address(0);
+}
+
+Instruction* Functor::address(size_t offset) const
+{
+    if (offset >= m_sealedLength) {
+        // Cast necessary because there are two overloads of data(), and the const one gets called here
+        return (Instruction*)m_buffer.data() + (offset - m_sealedLength);
+    }
+    auto segment = std::upper_bound(m_segments.begin(), m_segments.end(), offset, [](size_t offset, const Segment& segment) {
+        return offset < segment.m_start;
+    }) - 1;
+    return (Instruction*)segment->m_code.data() + (offset - segment->m_start);
 }
 
 Instruction** Functor::jumpTable() const
@@ -48,7 +62,27 @@ Instruction** Functor::jumpTable() const
 
 size_t Functor::length() const
 {
-    return m_buffer.size();
+    return m_sealedLength + m_buffer.size();
+}
+
+size_t Functor::capacity() const
+{
+    return m_sealedLength + m_buffer.capacity();
+}
+
+void Functor::seal()
+{
+    if (m_buffer.empty()) {
+        return;
+    }
+    if (m_buffer.size() % 2 == 1) {
+        add(nop());
+    }
+    // Moving the vector keeps its storage, so only the spare capacity has to be given back
+    m_buffer.shrink_to_fit();
+    m_segments.push_back(Segment{ m_sealedLength, std::move(m_buffer) });
+    m_sealedLength += m_segments.back().m_code.size();
+    m_buffer = std::vector<Instruction>();
 }
 
 f_void Functor::fp()
@@ -62,7 +96,12 @@ f_void Functor::fp()
 
 void Functor::print()
 {
-    printFunction(fp(), length());
+    for (auto& segment : m_segments) {
+        printFunction((f_void)((unsigned int)segment.m_code.data() | 0x1), segment.m_code.size());
+    }
+    if (!m_buffer.empty()) {
+        printFunction((f_void)((unsigned int)m_buffer.data() | 0x1), m_buffer.size());
+    }
 }
 
 void Functor::attachJumpTable(std::vector<Instruction*>&& jumpTable)
@@ -73,18 +112,27 @@ void Functor::attachJumpTable(std::vector<Instruction*>&& jumpTable)
     m_jumpTable = jumpTable;
 }
 
-void Functor::serialise()
+bool Functor::serialise()
 {
+    if (m_segments.size() + (m_buffer.empty() ? 0 : 1) > 1) {
+        printf("WARNING: Code in several segments can't be serialised\n");
+        return false;
+    }
     Transfer::Serialiser serialiser("bytecode");
-    serialiser.appendData((const uint8_t*)m_buffer.data(), m_buffer.size() * sizeof(Instruction));
+    auto code = buffer();
+    serialiser.appendData((const uint8_t*)code, length() * sizeof(Instruction));
+    return true;
 }
 
 void Functor::deserialise()
 {
     Transfer::Deserialiser deserialiser("bytecode");
     if (deserialiser.exists() && deserialiser.length() > 0) {
+        m_segments.clear();
+        m_sealedLength = 0;
         m_buffer = std::vector<Instruction>(deserialiser.length() / sizeof(Instruction), 0);
         deserialiser.readData((uint8_t*)m_buffer.data(), deserialiser.length());
+        seal();
         commit();
     }
 }
@@ -22,27 +22,63 @@ constexpr inline ReturnType typedCall(f_void fp, ArgumentTypes... args)
  *
  * Due to the Halting Problem it is not possible to guarantee that the function
  * will return, so please ensure that you add the return instruction.
+ *
+ * Instructions are added to a buffer that may move as it grows, until it is sealed into a segment whose address never
+ * changes. Code that is running must therefore be sealed so that new code can be added while it is on the call stack.
+ * Offsets are counted from the start of the first segment, but consecutive segments aren't adjacent in memory, so
+ * branches between them have to use distance rather than the difference of their offsets.
  */
 class Functor {
 private:
+    struct Segment {
+        size_t m_start;
+        std::vector<Instruction> m_code;
+    };
+
+    std::vector<Segment> m_segments;
+    size_t m_sealedLength;
     std::vector<Instruction> m_buffer;
     std::vector<Instruction*> m_jumpTable;
     bool m_hasChanges;
 
 public:
     Functor()
-        : m_buffer(0)
+        : m_segments()
+        , m_sealedLength(0)
+        , m_buffer(0)
         , m_jumpTable(0)
         , m_hasChanges(false)
     {
     }
 
-    void serialise();
+    /// Returns false without writing anything if the code is split across segments, as it can't be loaded elsewhere
+    bool serialise();
     void deserialise();
 
     Instruction** jumpTable() const;
+
+    /// The first instruction, which is only contiguous with those in the same segment
     Instruction* buffer() const;
+
+    /// The instruction at |offset|, which may be one past the last instruction
+    Instruction* address(size_t offset) const;
+
+    /// The number of instructions from |from| to |to| in memory, which also works between segments
+    int distance(size_t from, size_t to) const { return (int)(address(to) - address(from)); }
+
     size_t length() const;
+
+    /// The number of instructions that fit before the buffer has to grow, including those that are sealed
+    size_t capacity() const;
+
+    /**
+     * Moves the instructions added since the last call into a new segment that never moves, padded to an even length
+     * so that offsets keep the word alignment of addresses. Nothing is sealed if there are no new instructions.
+     */
+    void seal();
+
+    /// Whether the instruction at |offset| is in a segment, i.e. it was added before the last call to seal
+    bool isSealed(size_t offset) const { return offset < m_sealedLength; }
     f_void fp();
 
     /**
@@ -51,9 +87,9 @@ public:
     void commit();
 
     /**
-     * WARNING: This should be removed once the relocating mechanism has been written
+     * Discards everything after the first |length| instructions, which must not be sealed
      */
-    void reserve(size_t minimumInstructions);
+    void truncate(size_t length);
 
     void add(Instruction x);
     void add(InstructionPair pair);
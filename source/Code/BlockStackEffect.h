@@ -29,6 +29,17 @@ private:
 public:
     BlockStackEffect(Code::Iterator iter);
 
+    /**
+     * Used for an effect combined from several basic blocks
+     */
+    BlockStackEffect(int popCount, int pushCount, int heightDifference)
+        : m_deterministicPops(true)
+        , m_popCount(popCount)
+        , m_pushCount(pushCount)
+        , m_heightDifference(heightDifference)
+    {
+    }
+
     /**
      * Indicates that there are NTUCK, NDUP, or NROT instructions for which we could not determine the number of values
      * that must be present on the stack already. This doesn't actually matter in practice because in this case a
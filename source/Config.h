@@ -21,7 +21,12 @@
  * Please sort alphabetically
  */
 
-const bool AllowPCRelativeLoads = false;
+/**
+ * Constants that take more than three instructions to build are loaded from a literal pool shared by each function.
+ * Pools are placed between basic blocks that execution can't fall through, or behind a branch if a block is long
+ * enough for a load to go out of range.
+ */
+const bool AllowPCRelativeLoads = true;
 
 const bool AlwaysPrintCompilation = false;
 
@@ -38,9 +43,35 @@ const int BrightnessFactor = 4;
 
 const bool BoundsCheckElimination = true;
 
+/**
+ * Conditional jumps are reserved in their short form, and a function is compiled again with the long form for any that
+ * can't reach their destination. Otherwise every conditional jump pays for the long form.
+ */
+const bool BranchRelaxation = true;
+
 /// Opposed to interpreting them
 const bool CompileOptionalInstructionTests = true;
 
+/**
+ * The heap memory, in bytes, that a Compiler may use, or 0 for no limit. Each time that a compiled function leaves the
+ * projected footprint over budget, the functions are compiled again with less code: first with the naive register
+ * allocator, then (for the first compilation only) with StackCheck::BoundsCheckByCall, and then with the largest
+ * function without loops left to the interpreter, until the projection fits. This can be overridden per Compiler.
+ *
+ * See Compiler::peakMemoryUsage
+ */
+const int CompilerMemoryBudget = 0;
+
+/**
+ * Allows JMP and CJMP with a destination that isn't the preceding push. The static analysis follows the constants
+ * pushed by the function to the jump, and those that can reach it are made basic blocks. The compiled jump looks up
+ * the destination in a table with an entry for each bytecode offset. A function with a jump whose destination is
+ * computed from something other than these constants is left to the interpreter, see InterpreterFallback.
+ *
+ * See ComputedJumpTargets and Compiler::attachJumpTable
+ */
+const bool ComputedJumps = true;
+
 enum class ConditionalBranchType {
     Naive,
     FewerBranches
@@ -63,6 +94,38 @@ static const char* ConditionalBranchType_Strings[] = {
  */
 const bool EnsureZeroesAfterStack = true;
 
+/**
+ * Functions whose stack effect can be determined statically (including that of the functions they call) get a single
+ * bounds check at their entry for the deepest pop and highest push along any path, and none in their other basic
+ * blocks. A function's effect can't be determined if it is recursive, makes dynamic calls, uses NDUP, NTUCK or NROT
+ * without a constant, or has a loop that changes the height of the stack. Such functions use per-block checks.
+ *
+ * See StaticAnalysis::stackEffectForFunction
+ */
+const bool FunctionLevelBoundsChecks = false;
+
+/**
+ * Only applies to the StackWithCopyOnWrite and StackScheduling register allocators. Rather than returning to the naive state at the end of
+ * every basic block, up to four stack values are kept in r2, r4, r6, and r7 across jumps and fall-throughs within a
+ * function, so loop-carried values can stay in registers across back edges. The first edge compiled to a block fixes
+ * the layout it is entered with; other edges emit moves, loads, and stores to reconcile with it. Function entries and
+ * blocks that are jumped to from other functions always use the naive state.
+ */
+const bool FunctionLevelRegisterAllocation = false;
+
+/**
+ * Calls to the function on top of the stack remember the function they last called, and call it directly while the
+ * target stays the same. Other targets go through the dynamic compiler, which updates the call site.
+ */
+const bool InlineCaching = true;
+
+/**
+ * A function that fails to compile with Compiler::Status::UnsupportedVariableJump or RegisterAllocationError is
+ * replaced by a stub that interprets it (and the functions it calls), rather than the whole compilation failing. The
+ * rest of the program is still compiled.
+ */
+const bool InterpreterFallback = true;
+
 enum class ProjectMode {
     UnitTests,
     OptionalInstructionTests,
@@ -86,14 +149,20 @@ static const char* ProjectMode_Strings[] = {
  *  - Doesn't perform correctness checks
  *  - Executes the |preTest| |TestExecutionCount| times to get a sample for how long that takes
  *  - Executes |preTest| and the code itself |TestExecutionCount| times for comparison
+ *  - Compares the StackWithCopyOnWrite and StackScheduling register allocators on Mark's programs
  */
 const bool ProfilingEnabled = false;
 
+/**
+ * StackScheduling extends StackWithCopyOnWrite with intra-block scheduling of memory traffic based on Koopman's
+ * paper, see RegisterFileStateSchedulingAllocator.h. The register allocation mode can be overridden per Compiler, which
+ * is used for comparing the allocators when profiling.
+ */
 enum class RegisterAllocation {
     Naive,
     Stack,
     StackWithCopyOnWrite,
-    // TODO: intra-block scheduling algorithm based on Koopman's paper
+    StackScheduling
 };
 
 const RegisterAllocation RegisterAllocationMode = RegisterAllocation::StackWithCopyOnWrite;
@@ -101,9 +170,18 @@ const RegisterAllocation RegisterAllocationMode = RegisterAllocation::StackWithC
 static const char* RegisterAllocation_Strings[] = {
     STR_NAME(RegisterAllocation::Naive),
     STR_NAME(RegisterAllocation::Stack),
-    STR_NAME(RegisterAllocation::StackWithCopyOnWrite)
+    STR_NAME(RegisterAllocation::StackWithCopyOnWrite),
+    STR_NAME(RegisterAllocation::StackScheduling)
 };
 
+/**
+ * Div and Mod call a division routine written in assembly (JIT/Division.s) that takes its operands in r3 and ip,
+ * returns both the quotient and the remainder, and preserves every other register, rather than calling executeDiv and
+ * executeMod through the C calling convention. The register allocators then don't need to return to the naive state
+ * and reload the stack around them. Max, Min, and Size are compiled inline.
+ */
+const bool RegisterPreservingHelpers = true;
+
 /**
  * Maintains an internal map of register contents so that writing to registers can be optimised
  * away until the last moment. Also allows for more efficient arithmetic operations in some cases
@@ -174,10 +252,9 @@ const bool RegisterWriteElimination = true;
  *
  * Potential performance improvements that can be done:
  *
- *  -   Currently registers r8 and r9 are completely unused by any part of the compiler. These could be used
- *      to store the values of the stack base and stack end throughout program execution, which would eliminate
- *      the need to ever do loads, reducing the cost of each approach by 2-4 cycles and 2-4 bytes (depending on
- *      whether it pushes xor pops, or does both)
+ *  -   Registers r8 and r9 now store the values of the stack base and stack end throughout program execution, which
+ *      eliminates the need to ever do loads, reducing the cost of each approach by 2-4 cycles and 2-4 bytes (depending
+ *      on whether it pushes xor pops, or does both)
  *  -   Do the addition to the existing stack pointer just before calling the stack check code. This will reduce
  *      the cycle cost by 1 in cases where an add/sub operation can be used as described above, but increase
  *      the size per basic-block by 2 bytes
@@ -193,22 +270,67 @@ const bool RegisterWriteElimination = true;
  *      count by 3 in most cases. The disadvantage of this approach is that you couldn't tell by how much the stack
  *      would overflow, but this can be derived from basic block metadata if absolutely necessary.
  *
- *      This approach will be implemented as BoundsCheckInPlaceOnStackPointerRegister
+ *      This approach is implemented as BoundsCheckInPlaceOnStackPointerRegister, although without the copy divided by
+ *      four: with r8 and r9 holding the bounds the stack pointer register can be moved in place with a single add/sub
+ *      (8-bit immediate) for up to 63 values, so the shift would only add a cycle. Instead the check for pushes leaves
+ *      the stack pointer register moved and the COW allocators treat it as an offset from the top of stack, which
+ *      saves the instruction restoring it. A single pop is checked in TempRegister, so it doesn't need restoring
+ *      either. Branches that skip such a check must make the adjustment themselves, so conditional branches can't
+ *      skip them.
  */
 enum class StackCheck {
     None,
-    BoundsCheckInPlace
+    BoundsCheckInPlace,
+    BoundsCheckInPlaceOnStackPointerRegister,
+    /**
+     * The call-based approach described above, but using r8 and r9 rather than loads. Each basic block loads its
+     * pop/push counts into r3 (and r5 if it does both) and calls one of three shared checks. This costs 3 cycles per
+     * basic block for the call and a further 3 for the return, but a check is at most 4 instructions (usually 3).
+     * Every function has to push LR as the calls overwrite it, which also prevents tail call optimisation.
+     */
+    BoundsCheckByCall
 };
 
 const StackCheck StackCheckMode = StackCheck::BoundsCheckInPlace;
 
 static const char* StackCheck_Strings[] = {
     STR_NAME(StackCheck::None),
-    STR_NAME(StackCheck::FewerBranches)
+    STR_NAME(StackCheck::BoundsCheckInPlace),
+    STR_NAME(StackCheck::BoundsCheckInPlaceOnStackPointerRegister),
+    STR_NAME(StackCheck::BoundsCheckByCall)
 };
 
+/**
+ * Only applies to the StackWithCopyOnWrite and StackScheduling register allocators. Mul by a known constant with at most
+ * two bits set (or its negation, or one less than a power of two) is compiled to shifts and adds. Div and Mod by a
+ * known divisor are compiled to shifts for powers of two and to a multiplication by the divisor's reciprocal otherwise,
+ * rather than calling the division routine. Div and Mod also require RegisterPreservingHelpers.
+ */
+const bool StrengthReduction = true;
+
 const bool TailCallsOptimised = true;
 
 const int TestExecutionCount = 5;
 
+/**
+ * Execution starts in the interpreter, which counts the calls and back edges of each function. Once a function reaches
+ * TieredCompilationThreshold it is compiled (along with the functions it calls) and further calls to it run the native
+ * code. This gives fast startup for large programs, and native code only uses RAM for code that is actually hot. A
+ * function that is compiled whilst the interpreter is in one of its loops moves to the native code at the next back
+ * edge (on-stack replacement), so long running loops don't have to wait for the function to be called again.
+ *
+ * See JIT::TieredExecution
+ */
+const bool TieredCompilation = false;
+
+const int TieredCompilationThreshold = 8;
+
+/**
+ * The compiler tries to prove that the whole program has a bounded stack effect (see FunctionLevelBoundsChecks). If
+ * it does then the only stack check is a single one before calling the Stack code, as the stack passed at runtime may
+ * already hold values, and no basic block has a check. The proven depth is available from
+ * Compiler::provenMaximumStackDepth so that the stack storage can be sized to fit.
+ */
+const bool WholeProgramStackBounds = false;
+
 const bool WriteCompiledCodeToFlash = true;
@@ -10,6 +10,7 @@
 // Forward declaration
 namespace JIT {
 class Compiler;
+class TieredExecution;
 }
 
 namespace Environment {
@@ -33,6 +34,10 @@ struct VM {
         , m_compiler(nullptr)
         , m_compileOrInterpretFunction(nullptr)
         , m_status(VMStatus::Success)
+        , m_dynamicCallReturnAddress(0)
+        , m_tieredExecution(nullptr)
+        , m_nativeEntryFunction(nullptr)
+        , m_nativeEntryBlock(nullptr)
     {
     }
 
@@ -55,6 +60,20 @@ struct VM {
     VMFunction m_compileOrInterpretFunction;
     VMStatus m_status;
 
+    /// The return address of the last call to compileFunctionDynamicallyASM, used to find the call site for InlineCaching
+    uint32_t m_dynamicCallReturnAddress;
+
+    // New members must be added after this point as their offsets are used in assembly
+
+    /// Only set for tiered execution, in which case the interpreter calls native code through this
+    JIT::TieredExecution* m_tieredExecution;
+
+    /// The Stack function called by entry code compiled with JIT::Compiler::compileIndirectEntry
+    VMFunction m_nativeEntryFunction;
+
+    /// The basic block jumped to for on-stack replacement, see JIT::Compiler::onStackReplacementEntry
+    VMFunction m_nativeEntryBlock;
+
     inline void reset()
     {
         m_programCounter = 0;
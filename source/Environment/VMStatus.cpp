@@ -10,7 +10,8 @@ static const char* vmStatusStrings[] = {
     "StackOverflow",
     "StackUnderflow",
     "OutOfBoundsFetch",
-    "CompilerError"
+    "CompilerError",
+    "IllegalJump"
 };
 
 const char* VMStatusString(VMStatus status)
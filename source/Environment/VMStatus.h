@@ -17,7 +17,8 @@ enum class VMStatus : uint32_t {
     StackOverflow = 2,
     StackUnderflow = 3,
     OutOfBoundsFetch = 4,
-    CompilerError = 5
+    CompilerError = 5,
+    IllegalJump = 6
 };
 
 const char* VMStatusString(VMStatus status);
@@ -4,9 +4,30 @@
 
 namespace JIT {
 
+/**
+ * Keeps the offsets that the register allocator has to use for loads and stores small enough to encode
+ */
+const int MaximumStackPointerOffsetAfterCheck = 16;
+
+static bool canAdjustStackPointerThroughArithmetic(Code::BlockStackEffect effect)
+{
+    return effect.popCount() * 4 + effect.pushCount() * 4 < 256;
+}
+
+int BoundsCheckCodeGenerator::stackPointerOffsetAfterCheck(Code::BlockStackEffect effect, bool leaveStackPointerAdjusted, StackCheck mode)
+{
+    if (mode != StackCheck::BoundsCheckInPlaceOnStackPointerRegister || !leaveStackPointerAdjusted) {
+        return 0;
+    }
+    if (effect.pushCount() == 0 || effect.pushCount() > MaximumStackPointerOffsetAfterCheck || !canAdjustStackPointerThroughArithmetic(effect)) {
+        return 0;
+    }
+    return effect.pushCount();
+}
+
 void BoundsCheckCodeGenerator::compile(Code::BlockStackEffect effect)
 {
-    if (StackCheckMode == StackCheck::None) {
+    if (m_mode == StackCheck::None) {
         return;
     }
 
@@ -16,14 +37,21 @@ void BoundsCheckCodeGenerator::compile(Code::BlockStackEffect effect)
         return;
     }
 
+    if (m_mode == StackCheck::BoundsCheckByCall) {
+        compileCall(effect);
+        return;
+    }
+
     m_func->add(ARM::moveGeneral(TempRegister3, ARM::Register::pc));
 
-    auto canAdjustStackPointerThroughArithmetic = popCount * 4 + pushCount * 4 < 256;
     int offset = 0;
 
     if (popCount != 0) {
         auto reg = TempRegister;
-        if (canAdjustStackPointerThroughArithmetic) {
+        if (m_mode == StackCheck::BoundsCheckInPlaceOnStackPointerRegister && pushCount == 0 && popCount * 4 < 8) {
+            // Doesn't need the stack pointer register to be restored afterwards
+            m_func->add(ARM::addSmallImm(TempRegister, StackPointerRegister, popCount * 4));
+        } else if (canAdjustStackPointerThroughArithmetic(effect)) {
             reg = StackPointerRegister;
             m_func->add(ARM::addLargeImm(StackPointerRegister, popCount * 4));
             offset += popCount * 4;
@@ -41,7 +69,7 @@ void BoundsCheckCodeGenerator::compile(Code::BlockStackEffect effect)
 
     if (pushCount != 0) {
         auto reg = TempRegister;
-        if (canAdjustStackPointerThroughArithmetic) {
+        if (canAdjustStackPointerThroughArithmetic(effect)) {
             reg = StackPointerRegister;
             m_func->add(ARM::subLargeImm(StackPointerRegister, (popCount + pushCount) * 4));
             offset -= (popCount + pushCount) * 4;
@@ -49,7 +77,7 @@ void BoundsCheckCodeGenerator::compile(Code::BlockStackEffect effect)
             if (pushCount * 4 < 8) {
                 m_func->add(ARM::subSmallImm(TempRegister, StackPointerRegister, pushCount * 4));
             } else {
-                compileLoadConstant(*m_func, popCount * 4, TempRegister);
+                compileLoadConstant(*m_func, pushCount * 4, TempRegister);
                 m_func->add(ARM::subReg(TempRegister, StackPointerRegister, TempRegister));
             }
         }
@@ -57,6 +85,9 @@ void BoundsCheckCodeGenerator::compile(Code::BlockStackEffect effect)
         m_linker->addStackOverflowCheck(*m_func);
     }
 
+    // The register allocator accounts for the stack pointer being left below the top of stack
+    offset += stackPointerOffsetAfterCheck(effect, m_leaveStackPointerAdjusted, m_mode) * 4;
+
     if (offset > 0) {
         m_func->add(ARM::subLargeImm(StackPointerRegister, offset));
     } else if (offset < 0) {
@@ -64,17 +95,37 @@ void BoundsCheckCodeGenerator::compile(Code::BlockStackEffect effect)
     }
 }
 
-void BoundsCheckCodeGenerator::compile(Code::BlockStackEffect effect, ARM::Functor& func, Linker& linker)
+void BoundsCheckCodeGenerator::compileCall(Code::BlockStackEffect effect)
+{
+    auto popCount = effect.popCount();
+    auto pushCount = effect.pushCount();
+
+    // See Compiler::compileStackCheckCallCode for the registers that the shared checks expect
+    if (popCount != 0 && pushCount != 0) {
+        compileLoadConstant(*m_func, popCount * 4, TempRegister);
+        compileLoadConstant(*m_func, pushCount * 4, TempRegister3);
+        m_linker->addStackCheckCall(*m_func);
+    } else if (popCount != 0) {
+        compileLoadConstant(*m_func, popCount * 4, TempRegister);
+        m_linker->addStackUnderflowCheckCall(*m_func);
+    } else {
+        compileLoadConstant(*m_func, pushCount * 4, TempRegister);
+        m_linker->addStackOverflowCheckCall(*m_func);
+    }
+}
+
+void BoundsCheckCodeGenerator::compile(Code::BlockStackEffect effect, ARM::Functor& func, Linker& linker, bool leaveStackPointerAdjusted, StackCheck mode)
 {
-    BoundsCheckCodeGenerator generator(&func, &linker);
+    BoundsCheckCodeGenerator generator(&func, &linker, leaveStackPointerAdjusted, mode);
     generator.compile(effect);
 }
 
-size_t BoundsCheckCodeGenerator::numberOfInstructions(Code::BlockStackEffect effect)
+size_t BoundsCheckCodeGenerator::numberOfInstructions(Code::BlockStackEffect effect, bool leaveStackPointerAdjusted, StackCheck mode)
 {
     ARM::Functor temporaryFunctor;
-    Linker temporaryLinker;
-    BoundsCheckCodeGenerator generator(&temporaryFunctor, &temporaryLinker);
+    Support::Arena temporaryArena;
+    Linker temporaryLinker(temporaryArena);
+    BoundsCheckCodeGenerator generator(&temporaryFunctor, &temporaryLinker, leaveStackPointerAdjusted, mode);
     generator.compile(effect);
     return temporaryFunctor.length();
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Config.h"
+
 #include "Code/BlockStackEffect.h"
 #include "Linker.h"
 
@@ -9,18 +11,37 @@ class BoundsCheckCodeGenerator {
 private:
     ARM::Functor* m_func;
     Linker* m_linker;
+    bool m_leaveStackPointerAdjusted;
+    StackCheck m_mode;
 
-    BoundsCheckCodeGenerator(ARM::Functor* func, Linker* linker)
+    BoundsCheckCodeGenerator(ARM::Functor* func, Linker* linker, bool leaveStackPointerAdjusted, StackCheck mode)
         : m_func(func)
         , m_linker(linker)
+        , m_leaveStackPointerAdjusted(leaveStackPointerAdjusted)
+        , m_mode(mode)
     {
     }
 
     void compile(Code::BlockStackEffect effect);
 
+    /// Used for StackCheck::BoundsCheckByCall
+    void compileCall(Code::BlockStackEffect effect);
+
 public:
-    static void compile(Code::BlockStackEffect effect, ARM::Functor& func, Linker& linker);
+    /**
+     * |leaveStackPointerAdjusted| should only be true if the register allocator can absorb an offset between the stack
+     * pointer register and the top of stack, see stackPointerOffsetAfterCheck. |mode| may differ from StackCheckMode
+     * for a compiler that has had to step down to smaller checks to fit its memory budget.
+     */
+    static void compile(Code::BlockStackEffect effect, ARM::Functor& func, Linker& linker, bool leaveStackPointerAdjusted = false, StackCheck mode = StackCheckMode);
+
+    static size_t numberOfInstructions(Code::BlockStackEffect effect, bool leaveStackPointerAdjusted = false, StackCheck mode = StackCheckMode);
 
-    static size_t numberOfInstructions(Code::BlockStackEffect effect);
+    /**
+     * In the BoundsCheckInPlaceOnStackPointerRegister mode the check for pushes leaves the stack pointer register
+     * pointing at the lowest value that the block may push rather than restoring it. Returns the number of words that
+     * the top of stack is then above the stack pointer register, which is always 0 in other modes.
+     */
+    static int stackPointerOffsetAfterCheck(Code::BlockStackEffect effect, bool leaveStackPointerAdjusted, StackCheck mode = StackCheckMode);
 };
 }
\ No newline at end of file
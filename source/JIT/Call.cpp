@@ -18,9 +18,9 @@ bool Call::linkStackCode(ARM::Functor& func, size_t realDestinationOffset)
 {
     int i = (int)insertionOffset();
 
-    auto pair = ARM::branchAndLinkNatural((int)realDestinationOffset - (int)i);
-    func.buffer()[i] = pair.instruction1;
-    func.buffer()[i + 1] = pair.instruction2;
+    auto pair = ARM::branchAndLinkNatural(func.distance(i, realDestinationOffset));
+    func.address(i)[0] = pair.instruction1;
+    func.address(i)[1] = pair.instruction2;
     
     return true;
 }
@@ -0,0 +1,72 @@
+#include "CallGraph.h"
+
+#include <algorithm>
+
+namespace JIT {
+
+size_t CallGraph::addFunction()
+{
+    m_nodes.emplace_back();
+    return m_nodes.size() - 1;
+}
+
+void CallGraph::addTailCall(size_t caller, size_t callee)
+{
+    m_nodes[caller].m_tailCallees.push_back(callee);
+}
+
+void CallGraph::setClobbersLinkRegister(size_t node)
+{
+    m_nodes[node].m_clobbersLinkRegister = true;
+}
+
+void CallGraph::resolve()
+{
+    int index = 0;
+    std::vector<size_t> stack;
+    for (size_t node = 0; node < m_nodes.size(); ++node) {
+        if (m_nodes[node].m_index < 0) {
+            resolveComponents(node, index, stack);
+        }
+    }
+}
+
+void CallGraph::resolveComponents(size_t node, int& index, std::vector<size_t>& stack)
+{
+    auto& visited = m_nodes[node];
+    visited.m_index = index;
+    visited.m_lowLink = index;
+    ++index;
+    stack.push_back(node);
+    visited.m_onStack = true;
+
+    for (auto callee : visited.m_tailCallees) {
+        if (m_nodes[callee].m_index < 0) {
+            resolveComponents(callee, index, stack);
+            m_nodes[node].m_lowLink = std::min(m_nodes[node].m_lowLink, m_nodes[callee].m_lowLink);
+        } else if (m_nodes[callee].m_onStack) {
+            m_nodes[node].m_lowLink = std::min(m_nodes[node].m_lowLink, m_nodes[callee].m_index);
+        }
+    }
+
+    if (m_nodes[node].m_lowLink != m_nodes[node].m_index) {
+        return;
+    }
+
+    // Components are completed callees first, so the callees outside this component have already been resolved
+    auto componentStart = std::find(stack.begin(), stack.end(), node);
+    bool savesLinkRegister = false;
+    for (auto member = componentStart; member != stack.end(); ++member) {
+        auto& function = m_nodes[*member];
+        savesLinkRegister |= function.m_clobbersLinkRegister;
+        for (auto callee : function.m_tailCallees) {
+            savesLinkRegister |= !m_nodes[callee].m_onStack && m_nodes[callee].m_savesLinkRegister;
+        }
+    }
+    for (auto member = componentStart; member != stack.end(); ++member) {
+        m_nodes[*member].m_savesLinkRegister = savesLinkRegister;
+        m_nodes[*member].m_onStack = false;
+    }
+    stack.erase(componentStart, stack.end());
+}
+}
\ No newline at end of file
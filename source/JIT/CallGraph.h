@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Config.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace JIT {
+
+/**
+ * The tail calls between the functions found by a single static analysis, used to decide which functions have to
+ * save LR on entry. A tail call is compiled as a branch, which keeps LR intact, but only if neither the caller nor the
+ * callee saves LR, as a branch skips the push at the start of the callee. So a function has to save LR if it clobbers
+ * LR itself (with a call that isn't a tail call, or a helper called with BL) or if it tail calls a function that does.
+ *
+ * Mutually tail recursive functions form a cycle, so they are resolved together as a strongly connected component.
+ */
+class CallGraph {
+private:
+    struct Node {
+        std::vector<size_t> m_tailCallees;
+        bool m_clobbersLinkRegister = false;
+        bool m_savesLinkRegister = false;
+
+        // Used by Tarjan's algorithm
+        int m_index = -1;
+        int m_lowLink = 0;
+        bool m_onStack = false;
+    };
+
+    std::vector<Node> m_nodes;
+
+    void resolveComponents(size_t node, int& index, std::vector<size_t>& stack);
+
+public:
+    /// Returns the node for a new function, numbered from zero in the order they are added
+    size_t addFunction();
+
+    void addTailCall(size_t caller, size_t callee);
+    void setClobbersLinkRegister(size_t node);
+
+    /// Must be called once every function and call has been added
+    void resolve();
+
+    bool savesLinkRegister(size_t node) const { return m_nodes[node].m_savesLinkRegister; }
+};
+}
\ No newline at end of file
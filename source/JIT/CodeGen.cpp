@@ -3,6 +3,7 @@
 #include "Bit/Bit.h"
 #include "Config.h"
 #include "DynamicCompilation.h"
+#include "Linker.h"
 
 namespace JIT {
 
@@ -14,9 +15,120 @@ const ARM::Register TempRegister2 = ARM::Register::r4;
 const ARM::Register TempRegister3 = ARM::Register::r5;
 const ARM::Register StackBaseRegister = ARM::Register::r8;
 const ARM::Register StackEndRegister = ARM::Register::r9;
+const ARM::Register HelperOperandRegister = ARM::Register::ip;
 
-void compileLoadConstant(ARM::Functor& func, int value, ARM::Register destination)
+/**
+ * A constant is built by a MOV of an 8-bit immediate followed by up to MaximumSynthesisSteps steps, each of which is a
+ * single instruction on the destination register
+ */
+const int MaximumSynthesisSteps = 3;
+
+enum class SynthesisStep : uint8_t {
+    ShiftLeft,
+    ArithmeticShiftRight,
+    Add,
+    Subtract,
+    Not,
+    Negate
+};
+
+struct ConstantSynthesis {
+    uint8_t m_move;
+    int m_stepCount;
+    SynthesisStep m_steps[MaximumSynthesisSteps];
+    uint8_t m_operands[MaximumSynthesisSteps];
+};
+
+static int trailingZeroes(uint32_t value)
+{
+    int count = 0;
+    while ((value & 1) == 0 && count < 32) {
+        value >>= 1;
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * Searches backwards from |value| for a sequence of exactly |stepCount| steps, undoing each possible last step. Shifts
+ * always shift as far as possible and additions only consider the low byte (or 255), which keeps the search small.
+ */
+static bool synthesiseConstant(uint32_t value, int stepCount, ConstantSynthesis& synthesis)
+{
+    if (stepCount == 0) {
+        if (value <= 0xFF) {
+            synthesis.m_move = (uint8_t)value;
+            return true;
+        }
+        return false;
+    }
+
+    auto index = stepCount - 1;
+    auto tryStep = [&](uint32_t previous, SynthesisStep step, uint8_t operand) {
+        if (previous == value || !synthesiseConstant(previous, index, synthesis)) {
+            return false;
+        }
+        synthesis.m_steps[index] = step;
+        synthesis.m_operands[index] = operand;
+        return true;
+    };
+
+    auto shift = trailingZeroes(value);
+    if (shift > 0 && shift < 32 && tryStep(value >> shift, SynthesisStep::ShiftLeft, (uint8_t)shift)) {
+        return true;
+    }
+
+    auto lowByte = (uint8_t)(value & 0xFF);
+    if (lowByte != 0 && tryStep(value - lowByte, SynthesisStep::Add, lowByte)) {
+        return true;
+    }
+    if (value > 0xFF && lowByte != 0xFF && tryStep(value - 0xFF, SynthesisStep::Add, 0xFF)) {
+        return true;
+    }
+
+    auto complement = (uint8_t)((0 - value) & 0xFF);
+    if (complement != 0 && tryStep(value + complement, SynthesisStep::Subtract, complement)) {
+        return true;
+    }
+
+    if (tryStep(~value, SynthesisStep::Not, 0) || tryStep(0 - value, SynthesisStep::Negate, 0)) {
+        return true;
+    }
+
+    // The largest shift that the sign bits of |value| allow
+    int arithmeticShift = 0;
+    while (arithmeticShift < 31 && (int32_t)(value << (arithmeticShift + 1)) >> (arithmeticShift + 1) == (int32_t)value) {
+        ++arithmeticShift;
+    }
+    if (arithmeticShift > 0 && tryStep(value << arithmeticShift, SynthesisStep::ArithmeticShiftRight, (uint8_t)arithmeticShift)) {
+        return true;
+    }
+
+    return false;
+}
+
+static bool synthesiseConstant(uint32_t value, ConstantSynthesis& synthesis)
 {
+    for (int stepCount = 0; stepCount <= MaximumSynthesisSteps; ++stepCount) {
+        if (synthesiseConstant(value, stepCount, synthesis)) {
+            synthesis.m_stepCount = stepCount;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// The original approach, which builds the constant byte by byte but can take up to eight instructions
+static int compileLoadConstantBytewise(ARM::Functor* func, int value, ARM::Register destination)
+{
+    int length = 0;
+    auto add = [&](ARM::Instruction instruction) {
+        if (func) {
+            func->add(instruction);
+        }
+        ++length;
+    };
+
     const bool isNegative = value < 0;
     if (isNegative) {
         value = -value;
@@ -29,29 +141,84 @@ void compileLoadConstant(ARM::Functor& func, int value, ARM::Register destinatio
         auto byte = Bit::uintRegion(absValue, 8 * b, 8);
         if (byte > 0 || (byte == 0 && b == 0)) {
             if (first) {
-                func.add(ARM::moveImmediate(destination, byte));
+                add(ARM::moveImmediate(destination, byte));
                 first = false;
             } else if (byte > 0) {
-                func.add(ARM::addLargeImm(destination, byte));
+                add(ARM::addLargeImm(destination, byte));
             }
             if (b != 0) {
-                func.add(ARM::logicalShiftLeftImmediate(destination, destination, 8));
+                add(ARM::logicalShiftLeftImmediate(destination, destination, 8));
             }
         } else {
             if (!first && b != 0) {
-                func.add(ARM::logicalShiftLeftImmediate(destination, destination, 8));
+                add(ARM::logicalShiftLeftImmediate(destination, destination, 8));
             }
         }
     }
 
     if (isNegative) {
-        func.add(ARM::neg(destination, destination));
+        add(ARM::neg(destination, destination));
     }
+    return length;
 }
 
-void compileCFunctionCall(ARM::Functor& func, Environment::VMFunction destination, bool needsToRestoreInvariant)
+int constantSynthesisLength(int value)
 {
-    bool startWasAlignedTo4ByteBoundary = ((int)&func.buffer()[func.length()]) % 4 == 0;
+    ConstantSynthesis synthesis;
+    if (synthesiseConstant((uint32_t)value, synthesis)) {
+        return synthesis.m_stepCount + 1;
+    }
+    return compileLoadConstantBytewise(nullptr, value, ARM::Register::r0);
+}
+
+void compileLoadConstant(ARM::Functor& func, int value, ARM::Register destination)
+{
+    ConstantSynthesis synthesis;
+    if (!synthesiseConstant((uint32_t)value, synthesis)) {
+        compileLoadConstantBytewise(&func, value, destination);
+        return;
+    }
+
+    func.add(ARM::moveImmediate(destination, synthesis.m_move));
+    for (int i = 0; i < synthesis.m_stepCount; ++i) {
+        auto operand = synthesis.m_operands[i];
+        switch (synthesis.m_steps[i]) {
+        case SynthesisStep::ShiftLeft:
+            func.add(ARM::logicalShiftLeftImmediate(destination, destination, operand));
+            break;
+        case SynthesisStep::ArithmeticShiftRight:
+            func.add(ARM::arithmeticShiftRightImm(destination, destination, operand));
+            break;
+        case SynthesisStep::Add:
+            func.add(ARM::addLargeImm(destination, operand));
+            break;
+        case SynthesisStep::Subtract:
+            func.add(ARM::subLargeImm(destination, operand));
+            break;
+        case SynthesisStep::Not:
+            func.add(ARM::moveNot(destination, destination));
+            break;
+        case SynthesisStep::Negate:
+            func.add(ARM::neg(destination, destination));
+            break;
+        }
+    }
+}
+
+void compileLoadConstant(ARM::Functor& func, int value, ARM::Register destination, LiteralPool* pool)
+{
+    // A PC relative load is a single instruction but also needs a word of data, and sometimes a halfword of padding to
+    // align it, so it costs at least as much as three instructions and only saves space over a longer sequence
+    if (pool && constantSynthesisLength(value) > 3) {
+        pool->addLoad(func, value, destination);
+        return;
+    }
+    compileLoadConstant(func, value, destination);
+}
+
+void compileCFunctionCall(ARM::Functor& func, Environment::VMFunction destination, bool needsToRestoreInvariant, Linker* linker)
+{
+    bool startWasAlignedTo4ByteBoundary = ((int)func.address(func.length())) % 4 == 0;
     int offset = 1;
     if (needsToRestoreInvariant) {
         offset += 1;
@@ -59,14 +226,22 @@ void compileCFunctionCall(ARM::Functor& func, Environment::VMFunction destinatio
 
     // The PC will be 2 instrutions after this, so either the first load or the unconditional branch
     // The offset is in multiples of 4
-    func.add(ARM::loadWordWithPCOffset(TempRegister, offset));
-    func.add(ARM::branchLinkExchangeToRegister(TempRegister));
+    if (linker) {
+        linker->addHelperCall(func, destination);
+    } else {
+        func.add(ARM::loadWordWithPCOffset(TempRegister, offset));
+        func.add(ARM::branchLinkExchangeToRegister(TempRegister));
+    }
 
     if (needsToRestoreInvariant) {
         func.add(ARM::loadWordWithOffset(StackPointerRegister, StatePointerRegister, offsetof(Environment::VM, m_stack.m_stackPointer) / sizeof(int32_t*)));
         func.add(ARM::loadWordWithOffset(StackTopRegister, StackPointerRegister, 0));
     }
 
+    if (linker) {
+        return;
+    }
+
     if (startWasAlignedTo4ByteBoundary) {
         func.add(ARM::unconditionalBranch(2));
         func.add(ARM::nop());
@@ -77,6 +252,14 @@ void compileCFunctionCall(ARM::Functor& func, Environment::VMFunction destinatio
     func.addData((int)destination);
 }
 
+void compileCFunctionVeneer(ARM::Functor& func, Environment::VMFunction destination)
+{
+    // The link register still holds the return address of the call site
+    func.add(ARM::loadWordWithPCOffset(TempRegister, 0));
+    func.add(ARM::branchAndExchange(TempRegister));
+    func.addData((int)destination);
+}
+
 void compileWriteStateToMemory(ARM::Functor& func)
 {
     // We only want to store the top of stack if the stack is not empty
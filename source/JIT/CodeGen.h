@@ -2,9 +2,12 @@
 
 #include "ARM/Functor.h"
 #include "Environment/VM.h"
+#include "LiteralPool.h"
 
 namespace JIT {
 
+class Linker;
+
 extern const ARM::Register StatePointerRegister;
 extern const ARM::Register StackPointerRegister;
 extern const ARM::Register StackTopRegister;
@@ -13,11 +16,26 @@ extern const ARM::Register TempRegister2;
 extern const ARM::Register TempRegister3;
 extern const ARM::Register StackBaseRegister;
 extern const ARM::Register StackEndRegister;
+/// The second operand of the register preserving stubs used for RegisterPreservingHelpers
+extern const ARM::Register HelperOperandRegister;
 
-/// Generates code for the full range of 32-bit integers
+/// Generates the shortest sequence that it can find for any 32-bit integer, which is never more than eight instructions
 void compileLoadConstant(ARM::Functor& func, int value, ARM::Register destination);
 
-void compileCFunctionCall(ARM::Functor& func, Environment::VMFunction destination, bool needsToRestoreInvariant = true);
+/// The number of instructions that compileLoadConstant emits for |value|
+int constantSynthesisLength(int value);
+
+/// Loads |value| from |pool| instead if that is shorter and |pool| isn't null
+void compileLoadConstant(ARM::Functor& func, int value, ARM::Register destination, LiteralPool* pool);
+
+/**
+ * Calls through the veneer for |destination| that |linker| shares between calls if it isn't null, otherwise the
+ * address of the function is placed inline after the call
+ */
+void compileCFunctionCall(ARM::Functor& func, Environment::VMFunction destination, bool needsToRestoreInvariant = true, Linker* linker = nullptr);
+
+/// The veneer for calls to |destination| through Linker::addHelperCall, which must be placed on a 4-byte boundary
+void compileCFunctionVeneer(ARM::Functor& func, Environment::VMFunction destination);
 
 void compileWriteStateToMemory(ARM::Functor& func);
 }
\ No newline at end of file
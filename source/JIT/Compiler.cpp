@@ -5,11 +5,13 @@
 #include "Bit/Bit.h"
 #include "BoundsCheckCodeGenerator.h"
 #include "Code/Iterator.h"
+#include "Division.h"
 #include "DynamicCompilation.h"
 #include "Interpreter.h"
 #include "RegisterFileStateCOWAllocator.h"
 #include "RegisterFileStateDefaultAllocator.h"
-#include "Support/Memory.h"
+#include "RegisterFileStateSchedulingAllocator.h"
+#include "StrengthReduction.h"
 #include <algorithm>
 #include <cstddef>
 #include <cstdio>
@@ -25,19 +27,52 @@ namespace JIT {
  */
 const int MaxArmInstructionsPerStackInstruction = 21;
 
+/**
+ * Used for AllowPCRelativeLoads. The number of instructions that may still be emitted after a literal pool is checked
+ * within a basic block and before it is checked again, which covers a single instruction as well as the code that
+ * returns to the naive state at the end of the block.
+ */
+const int LiteralPoolPlacementMargin = 3 * MaxArmInstructionsPerStackInstruction;
+
+/**
+ * Used for InlineCaching. The offsets of the parts of a call site compiled by Compiler::compileCachedDynamicCall that
+ * are patched, in instructions from its start.
+ */
+const int CachedCallBranchOffset = 5;
+const int CachedCallReturnOffset = 12;
+const int CachedCallTargetOffset = 14;
+
+/// Makes the call site that returns to |returnAddress| call |function| directly when its target is |target|
+void patchCachedDynamicCall(uint32_t returnAddress, int32_t target, Environment::VMFunction function)
+{
+    auto site = (ARM::Instruction*)(returnAddress & ~1) - CachedCallReturnOffset;
+    auto branch = &site[CachedCallBranchOffset];
+    auto pair = ARM::branchAndLinkNatural((int)((ARM::Instruction*)((uint32_t)function & ~1) - branch));
+    branch[0] = pair.instruction1;
+    branch[1] = pair.instruction2;
+    *(int32_t*)&site[CachedCallTargetOffset] = target;
+}
+
+/// Enough for any of the register allocators. The scheduling allocator extends the copy-on-write one.
+const size_t RegisterFileStateStorageSize = sizeof(RegisterFileStateSchedulingAllocator) > sizeof(RegisterFileStateDefaultAllocator) ? sizeof(RegisterFileStateSchedulingAllocator) : sizeof(RegisterFileStateDefaultAllocator);
+
+/// Whether execution can't continue past |instr| to the next instruction
+bool endsWithUnconditionalBranch(Code::Instruction instr)
+{
+    return instr == Code::Instruction::Jmp || instr == Code::Instruction::Ret || instr == Code::Instruction::Halt;
+}
+
 DynamicFunctionResult compileFunctionDynamically(Environment::VM* state, int32_t* stackPointer, int32_t topOfStack)
 {
     state->m_stack.m_stackPointer = ++stackPointer;
     if (state->m_compiler) {
         ARM::Functor& func = *(state->m_entryFunctor);
 
-        int32_t originalCodeLocation = (int32_t)func.buffer();
-
         if (!state->m_compiler->functionPointerForStackFunction(func, topOfStack)) {
             auto compilerSuccess = state->m_compiler->compileNewFunction(func, topOfStack);
             if (compilerSuccess != Compiler::Status::Success) {
                 printf("Compiler failure, will return nullptr\n");
-                return { state, nullptr, 0 };
+                return { state, nullptr };
             } else {
                 if (AlwaysPrintCompilation) {
                     state->m_compiler->prettyPrintCode(func);
@@ -46,17 +81,32 @@ DynamicFunctionResult compileFunctionDynamically(Environment::VM* state, int32_t
         }
 
         auto function = state->m_compiler->functionPointerForStackFunction(func, topOfStack);
+        // The jump table is rebuilt by each compilation
+        state->m_jumpTable = func.jumpTable();
 
-        int32_t newCodeLocation = (int32_t)func.buffer();
+        if (InlineCaching && function) {
+            patchCachedDynamicCall(state->m_dynamicCallReturnAddress, topOfStack, function);
+            func.commit();
+        }
 
-        return { state, function, newCodeLocation - originalCodeLocation };
+        return { state, function };
     } else {
         // Need to jump to the halt with error
         printf("WARNING: No compiler attached to handle dealing with function\n");
-        return { state, nullptr, 0 };
+        return { state, nullptr };
     }
 }
 
+Environment::VM* interpretFunctionForCompiledCode(Environment::VM* state, int32_t* stackPointer, int32_t topOfStack)
+{
+    bool returned = false;
+    state = execute(state, stackPointer, topOfStack, returned);
+    if (state->m_status != Environment::VMStatus::Success || !returned) {
+        state->m_programCounter = Compiler::HaltedProgramCounter;
+    }
+    return state;
+}
+
 void popNextToTemp(ARM::Functor& func)
 {
     func.add(ARM::addSmallImm(StackPointerRegister, StackPointerRegister, 4));
@@ -86,16 +136,6 @@ void compileMul(ARM::Functor& func)
     func.add(ARM::mul(StackTopRegister, TempRegister));
 }
 
-void compileDiv(ARM::Functor& func)
-{
-    compileCFunctionCall(func, &executeDiv);
-}
-
-void compileMod(ARM::Functor& func)
-{
-    compileCFunctionCall(func, &executeMod);
-}
-
 void compileInc(ARM::Functor& func)
 {
     func.add(ARM::addSmallImm(StackTopRegister, StackTopRegister, 1));
@@ -106,21 +146,33 @@ void compileDec(ARM::Functor& func)
     func.add(ARM::subSmallImm(StackTopRegister, StackTopRegister, 1));
 }
 
-void compileMax(ARM::Functor& func)
+void compileMax(ARM::Functor& func, Linker& linker)
 {
-    // TODO Assembly version (already implemented in non-naive version)
-    compileCFunctionCall(func, &executeMax);
+    if (!RegisterPreservingHelpers) {
+        compileCFunctionCall(func, &executeMax, true, &linker);
+        return;
+    }
+    popNextToTemp(func);
+    func.add(ARM::compareLowRegisters(TempRegister, StackTopRegister));
+    func.add(ARM::conditionalBranch(ARM::Condition::le, 0));
+    func.add(ARM::moveLowToLow(StackTopRegister, TempRegister));
 }
 
-void compileMin(ARM::Functor& func)
+void compileMin(ARM::Functor& func, Linker& linker)
 {
-    // TODO Assembly version (already implemented in non-naive version)
-    compileCFunctionCall(func, &executeMin);
+    if (!RegisterPreservingHelpers) {
+        compileCFunctionCall(func, &executeMin, true, &linker);
+        return;
+    }
+    popNextToTemp(func);
+    func.add(ARM::compareLowRegisters(TempRegister, StackTopRegister));
+    func.add(ARM::conditionalBranch(ARM::Condition::ge, 0));
+    func.add(ARM::moveLowToLow(StackTopRegister, TempRegister));
 }
 
-void Compiler::compileRandom(ARM::Functor& func) const
+void Compiler::compileRandom(ARM::Functor& func)
 {
-    compileCFunctionCall(func, m_device->resolveVirtualMachineFunction(Code::Instruction::Nrnd));
+    compileCFunctionCall(func, m_device->resolveVirtualMachineFunction(Code::Instruction::Nrnd), true, &m_linker);
 }
 
 void compileConditional(ARM::Functor& func, ARM::Condition c)
@@ -158,50 +210,84 @@ void compileSwap(ARM::Functor& func)
     func.add(ARM::moveLowToLow(StackTopRegister, TempRegister));
 }
 
-void compileRot(ARM::Functor& func)
+void compileRot(ARM::Functor& func, Linker& linker)
 {
-    compileCFunctionCall(func, &executeRot);
+    compileCFunctionCall(func, &executeRot, true, &linker);
 }
 
-void compileNrot(ARM::Functor& func)
+void compileNrot(ARM::Functor& func, Linker& linker)
 {
-    compileCFunctionCall(func, &executeNrot);
+    compileCFunctionCall(func, &executeNrot, true, &linker);
 }
 
-void compileTuck(ARM::Functor& func)
+void compileTuck(ARM::Functor& func, Linker& linker)
 {
-    compileCFunctionCall(func, &executeTuck);
+    compileCFunctionCall(func, &executeTuck, true, &linker);
 }
 
-void compileNtuck(ARM::Functor& func)
+void compileNtuck(ARM::Functor& func, Linker& linker)
 {
-    compileCFunctionCall(func, &executeNtuck);
+    compileCFunctionCall(func, &executeNtuck, true, &linker);
 }
 
-void compileSize(ARM::Functor& func)
+/// Leaves the number of values on the stack in TempRegister. Expects the naive state.
+void compileStackSize(ARM::Functor& func)
 {
-    compileCFunctionCall(func, &executeSize);
+    func.add(ARM::moveGeneral(TempRegister, StackEndRegister));
+    func.add(ARM::subReg(TempRegister, TempRegister, StackPointerRegister));
+    func.add(ARM::arithmeticShiftRightImm(TempRegister, TempRegister, 2));
 }
 
-void compileLoadConstant(ARM::Functor& func, int value, ARM::Register destination, bool allowPcRelativeLoad, std::vector<PCRelativeLoad>& relativeLoads)
+void compileSize(ARM::Functor& func, Linker& linker)
 {
-    if (allowPcRelativeLoad && (value < 0 || value > 0xFF)) {
-        relativeLoads.push_back(PCRelativeLoad(func, value, destination));
+    if (!RegisterPreservingHelpers) {
+        compileCFunctionCall(func, &executeSize, true, &linker);
         return;
     }
-    compileLoadConstant(func, value, destination);
+    compileStackSize(func);
+    func.add(ARM::storeWordWithOffset(StackTopRegister, StackPointerRegister, 0));
+    func.add(ARM::subSmallImm(StackPointerRegister, StackPointerRegister, 4));
+    func.add(ARM::moveLowToLow(StackTopRegister, TempRegister));
 }
 
-void compilePush(ARM::Functor& func, int value, bool allowPcRelativeLoad, std::vector<PCRelativeLoad>& relativeLoads)
+/**
+ * Used for RegisterPreservingHelpers. Calls divideAndModuloASM, which is too far away for a BL from the compiled code,
+ * preserving every register other than TempRegister and HelperOperandRegister.
+ */
+void compileDivisionVeneer(ARM::Functor& func)
+{
+    func.add(ARM::pushMultiple(true, ARM::RegisterList::r0));
+    auto literalLoad = func.length();
+    func.add(ARM::nop()); // Replaced with the load of the routine's address below
+    func.add(ARM::branchLinkExchangeToRegister(ARM::Register::r0));
+    func.add(ARM::popMultiple(true, ARM::RegisterList::r0));
+    if (((int)func.address(func.length())) % 4 != 0) {
+        func.add(ARM::nop());
+    }
+    auto literal = func.length();
+    func.addData((int)&divideAndModuloASM | 0x1);
+
+    // The PC is read as the address of the load plus 4, rounded down to a multiple of 4
+    auto pc = ((int)func.address(literalLoad) + 4) & ~3;
+    *func.address(literalLoad) = ARM::loadWordWithPCOffset(ARM::Register::r0, (uint8_t)(((int)func.address(literal) - pc) / 4));
+}
+
+/// The register that the division routine leaves the result of |instr| in, which is either Div or Mod
+ARM::Register divisionResultRegister(Code::Instruction instr)
+{
+    return instr == Code::Instruction::Div ? TempRegister : HelperOperandRegister;
+}
+
+void compilePush(ARM::Functor& func, int value, LiteralPool* pool)
 {
     func.add(ARM::storeWordWithOffset(StackTopRegister, StackPointerRegister, 0));
     func.add(ARM::subSmallImm(StackPointerRegister, StackPointerRegister, 4));
-    compileLoadConstant(func, value, StackTopRegister, allowPcRelativeLoad, relativeLoads);
+    compileLoadConstant(func, value, StackTopRegister, pool);
 }
 
-void Compiler::compileWait(ARM::Functor& func) const
+void Compiler::compileWait(ARM::Functor& func)
 {
-    compileCFunctionCall(func, m_device->resolveVirtualMachineFunction(Code::Instruction::Wait));
+    compileCFunctionCall(func, m_device->resolveVirtualMachineFunction(Code::Instruction::Wait), true, &m_linker);
 }
 
 void compileFetch(ARM::Functor& func, ARM::Register fromRegister, ARM::Register toRegister)
@@ -235,9 +321,9 @@ void compilePseudoCall(ARM::Functor& func)
 
 void compileCall(ARM::Functor& func, int i, int destination)
 {
-    auto pair = ARM::branchAndLinkNatural(destination - i);
-    func.buffer()[i] = pair.instruction1;
-    func.buffer()[i + 1] = pair.instruction2;
+    auto pair = ARM::branchAndLinkNatural(func.distance(i, destination));
+    func.address(i)[0] = pair.instruction1;
+    func.address(i)[1] = pair.instruction2;
 }
 
 void compileReturn(ARM::Functor& func)
@@ -311,11 +397,176 @@ void Compiler::compileStackUnderflowCode(ARM::Functor& func)
     m_linker.addHalt(func);
 }
 
-void Compiler::compileOptional(ARM::Functor& func, Code::Instruction optional, unsigned pushPop) const
+void Compiler::compileStackCheckErrorCode(ARM::Functor& func)
+{
+    if (m_stackCheckMode == StackCheck::BoundsCheckByCall) {
+        compileStackCheckCallCode(func);
+    } else if (m_stackCheckMode != StackCheck::None) {
+        compileStackOverflowCode(func);
+        compileStackUnderflowCode(func);
+    }
+}
+
+void Compiler::compileSegmentErrorCode(ARM::Functor& func)
+{
+    auto haltOffset = func.length();
+    if (m_hasIndirectEntry) {
+        compileLoadConstant(func, HaltedProgramCounter, TempRegister);
+        func.add(ARM::storeWordWithOffset(TempRegister, StatePointerRegister, offsetof(Environment::VM, m_programCounter) / sizeof(uint32_t)));
+    }
+    compileHaltCode(func);
+    m_linker.setHaltOffset(haltOffset);
+    if (m_stackCheckMode != StackCheck::BoundsCheckByCall) {
+        compileStackCheckErrorCode(func);
+    }
+    // Compiled again if the new functions use computed jumps
+    m_hasComputedJumpCode = false;
+}
+
+void Compiler::compileStackCheckCallCode(ARM::Functor& func)
+{
+    // Pops and pushes: r3 = popCount * 4, r5 = pushCount * 4
+    m_linker.setStackCheckCallOffset(func.length());
+    func.add(ARM::addReg(TempRegister, StackPointerRegister, TempRegister));
+    func.add(ARM::compareRegistersGeneral(TempRegister, StackEndRegister));
+    auto underflowBranch = func.length();
+    func.add(ARM::nop()); // Replaced with a branch to the underflow failure below
+    func.add(ARM::moveGeneral(TempRegister, TempRegister3));
+    // Falls through to the overflow check
+
+    // Pushes: r3 = pushCount * 4
+    m_linker.setStackOverflowCheckCallOffset(func.length());
+    func.add(ARM::subReg(TempRegister, StackPointerRegister, TempRegister));
+    func.add(ARM::compareRegistersGeneral(TempRegister, StackBaseRegister));
+    func.add(ARM::conditionalBranch(ARM::Condition::lt, 0)); // Skips the return
+    func.add(ARM::ret());
+    // The error code expects the check PC in temp register 3, which is the return address of the check instead
+    func.add(ARM::moveGeneral(TempRegister3, ARM::Register::lr));
+    compileStackOverflowCode(func);
+
+    // Pops: r3 = popCount * 4
+    m_linker.setStackUnderflowCheckCallOffset(func.length());
+    func.add(ARM::addReg(TempRegister, StackPointerRegister, TempRegister));
+    func.add(ARM::compareRegistersGeneral(TempRegister, StackEndRegister));
+    func.add(ARM::conditionalBranch(ARM::Condition::gt, 0));
+    func.add(ARM::ret());
+    auto underflowFailure = func.length();
+    func.add(ARM::moveGeneral(TempRegister3, ARM::Register::lr));
+    compileStackUnderflowCode(func);
+
+    *func.address(underflowBranch) = ARM::conditionalBranch(ARM::Condition::gt, (int)underflowFailure - (int)underflowBranch - 2);
+}
+
+void Compiler::compileComputedJumpCode(ARM::Functor& func)
+{
+    m_linker.setComputedJumpOffset(func.length());
+    compileLoadConstant(func, (int)m_source.length(), TempRegister2);
+    func.add(ARM::compareLowRegisters(TempRegister, TempRegister2));
+    func.add(ARM::conditionalBranch(ARM::Condition::hs, 3)); // Unsigned, so negative destinations are also illegal
+    func.add(ARM::logicalShiftLeftImmediate(TempRegister, TempRegister, 2));
+    func.add(ARM::loadWordWithOffset(TempRegister2, StatePointerRegister, offsetof(Environment::VM, m_jumpTable) / sizeof(uint32_t)));
+    func.add(ARM::loadWordWithRegisterOffset(TempRegister2, TempRegister2, TempRegister));
+    func.add(ARM::branchAndExchange(TempRegister2));
+
+    // The jump table entry for every offset that isn't a basic block
+    m_linker.setIllegalJumpOffset(func.length());
+    func.add(ARM::moveImmediate(TempRegister, (uint8_t)Environment::VMStatus::IllegalJump));
+    func.add(ARM::storeWordWithOffset(TempRegister, StatePointerRegister, offsetof(Environment::VM, m_status) / sizeof(int32_t*)));
+    m_linker.addHalt(func);
+
+    m_hasComputedJumpCode = true;
+}
+
+void Compiler::compileComputedJump(ARM::Functor& func, bool conditional)
+{
+    func.add(ARM::moveLowToLow(TempRegister, StackTopRegister));
+    if (conditional) {
+        func.add(ARM::loadWordWithOffset(TempRegister2, StackPointerRegister, 1));
+        func.add(ARM::addSmallImm(StackPointerRegister, StackPointerRegister, 8));
+        func.add(ARM::loadWordWithOffset(StackTopRegister, StackPointerRegister, 0));
+        func.add(ARM::compareImmediate(TempRegister2, 0));
+        // Skips the branch to the lookup
+        func.add(ARM::conditionalBranch(ARM::Condition::eq, 1));
+    } else {
+        func.add(ARM::addSmallImm(StackPointerRegister, StackPointerRegister, 4));
+        func.add(ARM::loadWordWithOffset(StackTopRegister, StackPointerRegister, 0));
+    }
+    m_linker.addComputedJump(func);
+}
+
+void Compiler::compileRegisterHelperCode(ARM::Functor& func)
+{
+    m_linker.setDivideCallOffset(func.length());
+    compileDivisionVeneer(func);
+    m_hasRegisterHelperCode = true;
+}
+
+void Compiler::compileHelperVeneers(ARM::Functor& func)
+{
+    // Copied because setting the offset removes the helper from the set
+    auto helpers = m_linker.helpersWithoutVeneers();
+    for (auto helper : helpers) {
+        if (func.length() % 2 == 1) {
+            func.add(ARM::nop());
+        }
+        m_linker.setHelperVeneerOffset(helper, func.length());
+        compileCFunctionVeneer(func, helper);
+    }
+}
+
+bool Compiler::functionsUseRegisterHelpers(const std::vector<Code::Region>& functions)
+{
+    for (auto function : functions) {
+        for (Code::Iterator iter(m_source, function); !iter.finished(); ++iter) {
+            if (iter.instruction() == Code::Instruction::Div || iter.instruction() == Code::Instruction::Mod) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void Compiler::compileRegisterHelperCall(ARM::Functor& func)
+{
+    m_linker.addDivideCall(func);
+}
+
+void Compiler::compileDivOrMod(ARM::Functor& func, Code::Instruction instr)
+{
+    if (!RegisterPreservingHelpers) {
+        compileCFunctionCall(func, instr == Code::Instruction::Div ? &executeDiv : &executeMod, true, &m_linker);
+        return;
+    }
+    popNextToTemp(func);
+    func.add(ARM::moveGeneral(HelperOperandRegister, StackTopRegister));
+    compileRegisterHelperCall(func);
+    func.add(ARM::moveGeneral(StackTopRegister, divisionResultRegister(instr)));
+}
+
+void Compiler::attachJumpTable(ARM::Functor& func)
+{
+    if (!m_analysis.hasComputedJumps()) {
+        return;
+    }
+    auto illegalJump = func.address(m_linker.illegalJumpOffset());
+    std::vector<ARM::Instruction*> jumpTable(m_source.length(), illegalJump);
+    for (size_t i = 0; i < m_source.length(); ++i) {
+        if (m_analysis.isComputedJumpTarget(i) && m_linker.hasOffsetForBasicBlock(i)) {
+            jumpTable[i] = func.address(m_linker.offsetForBasicBlock(i));
+        }
+    }
+    // The entries are used with BX, so must be Thumb addresses
+    for (auto& entry : jumpTable) {
+        entry = (ARM::Instruction*)((uint32_t)entry | 0x1);
+    }
+    func.attachJumpTable(std::move(jumpTable));
+}
+
+void Compiler::compileOptional(ARM::Functor& func, Code::Instruction optional, unsigned pushPop)
 {
     auto f = m_device->resolveVirtualMachineFunction(optional);
     if (f) {
-        compileCFunctionCall(func, f);
+        compileCFunctionCall(func, f, true, &m_linker);
     } else {
         int pushCount = Bit::uintRegion(pushPop, 4, 4);
         int popCount = Bit::uintRegion(pushPop, 0, 4);
@@ -340,14 +591,13 @@ void Compiler::compileOptional(ARM::Functor& func, Code::Instruction optional, u
     }
 }
 
-Compiler::Status Compiler::compileBasicBlockNaive(ARM::Functor& func, Code::Region basicBlock, Code::Region functionBlock, std::vector<PCRelativeLoad>& relativeLoads)
+Compiler::Status Compiler::compileBasicBlockNaive(ARM::Functor& func, Code::Region basicBlock, Code::Region functionBlock)
 {
-    int numberOfPushInstructions = 0;
     for (Code::Iterator iter(m_source, basicBlock); !iter.finished(); ++iter) {
-        const int maximumRemainingInstructionEstimate = (functionBlock.end() - iter.index()) * MaxArmInstructionsPerStackInstruction;
+        placeLiteralPoolIfNeeded(func);
 
-        if (iter.index() == basicBlock.start()) {
-            m_linker.setLinkOffset(iter.index(), func.length());
+        if (iter.index() == basicBlock.start() && !m_linker.setLinkOffset(iter.index(), func.length())) {
+            return Status::LinkerFailed;
         }
 
         if (m_analysis.isCallDestination(iter.index())) {
@@ -356,8 +606,8 @@ Compiler::Status Compiler::compileBasicBlockNaive(ARM::Functor& func, Code::Regi
             }
         }
 
-        if (StackCheckMode != StackCheck::None && iter.index() == basicBlock.start()) {
-            BoundsCheckCodeGenerator::compile(m_analysis.stackEffectForBasicBlock(basicBlock), func, m_linker);
+        if (m_stackCheckMode != StackCheck::None && iter.index() == basicBlock.start()) {
+            BoundsCheckCodeGenerator::compile(checkedStackEffectForBasicBlock(basicBlock), func, m_linker, false, m_stackCheckMode);
         }
 
         switch (iter.instruction()) {
@@ -371,10 +621,8 @@ Compiler::Status Compiler::compileBasicBlockNaive(ARM::Functor& func, Code::Regi
             compileMul(func);
             break;
         case Code::Instruction::Div:
-            compileDiv(func);
-            break;
         case Code::Instruction::Mod:
-            compileMod(func);
+            compileDivOrMod(func, iter.instruction());
             break;
         case Code::Instruction::Inc:
             compileInc(func);
@@ -383,10 +631,10 @@ Compiler::Status Compiler::compileBasicBlockNaive(ARM::Functor& func, Code::Regi
             compileDec(func);
             break;
         case Code::Instruction::Max:
-            compileMax(func);
+            compileMax(func, m_linker);
             break;
         case Code::Instruction::Min:
-            compileMin(func);
+            compileMin(func, m_linker);
             break;
         case Code::Instruction::Lt:
             compileConditional(func, ARM::Condition::lt);
@@ -416,19 +664,19 @@ Compiler::Status Compiler::compileBasicBlockNaive(ARM::Functor& func, Code::Regi
             compileSwap(func);
             break;
         case Code::Instruction::Rot:
-            compileRot(func);
+            compileRot(func, m_linker);
             break;
         case Code::Instruction::Nrot:
-            compileNrot(func);
+            compileNrot(func, m_linker);
             break;
         case Code::Instruction::Tuck:
-            compileTuck(func);
+            compileTuck(func, m_linker);
             break;
         case Code::Instruction::Ntuck:
-            compileNtuck(func);
+            compileNtuck(func, m_linker);
             break;
         case Code::Instruction::Size:
-            compileSize(func);
+            compileSize(func, m_linker);
             break;
         case Code::Instruction::Nrnd:
             compileRandom(func);
@@ -436,10 +684,7 @@ Compiler::Status Compiler::compileBasicBlockNaive(ARM::Functor& func, Code::Regi
         case Code::Instruction::Push8:
         case Code::Instruction::Push16:
             if (iter.currentIsSafePush() && !(iter.hasMoreInstructions() && isJumpOrCall(iter.nextInstruction()))) {
-                // Using an *extremely* conservative estimate for whether or not we'll have space for push
-                // instructions to use PC relative loads
-                compilePush(func, iter.pushValue(), ((numberOfPushInstructions + maximumRemainingInstructionEstimate) < 0xFF) && AllowPCRelativeLoads, relativeLoads);
-                numberOfPushInstructions++;
+                compilePush(func, iter.pushValue(), m_literalPool);
             }
             break;
         case Code::Instruction::Fetch:
@@ -449,6 +694,8 @@ Compiler::Status Compiler::compileBasicBlockNaive(ARM::Functor& func, Code::Regi
             if (iter.lastWasPush()) {
                 auto destination = iter.pushValue();
                 m_linker.addUnconditionalJump(func, destination, skipDistanceForBranch(basicBlock, destination));
+            } else if (ComputedJumps && !m_analysis.hasUnprovenComputedJumps(functionBlock.start())) {
+                compileComputedJump(func, false);
             } else {
                 printf("Unsupported non-constant jump at %d\n", (int)iter.index());
                 return Status::UnsupportedVariableJump;
@@ -459,6 +706,8 @@ Compiler::Status Compiler::compileBasicBlockNaive(ARM::Functor& func, Code::Regi
             if (iter.lastWasPush()) {
                 auto destination = iter.pushValue();
                 m_linker.addConditionalJump(func, destination, skipDistanceForBranch(basicBlock, destination));
+            } else if (ComputedJumps && !m_analysis.hasUnprovenComputedJumps(functionBlock.start())) {
+                compileComputedJump(func, true);
             } else {
                 printf("Unsupported non-constant conditional jump at %d\n", (int)iter.index());
                 return Status::UnsupportedVariableJump;
@@ -493,36 +742,177 @@ Compiler::Status Compiler::compileBasicBlockNaive(ARM::Functor& func, Code::Regi
     return Status::Success;
 }
 
-int Compiler::skipDistanceForBranch(Code::Region basicBlock, int destination)
+int Compiler::skipDistanceForBranch(Code::Region basicBlock, int destination, ARM::Functor* unconditionalBranch)
 {
     auto destinationBlock = m_analysis.basicBlockAtIndex(destination);
     auto selfEffect = m_analysis.stackEffectForBasicBlock(basicBlock);
-    auto destinationEffect = m_analysis.stackEffectForBasicBlock(destinationBlock);
+    auto destinationEffect = checkedStackEffectForBasicBlock(destinationBlock);
     auto canSkipBoundsCheck = BoundsCheckElimination && selfEffect.supersedes(destinationEffect);
-    auto skipCount = canSkipBoundsCheck ? BoundsCheckCodeGenerator::numberOfInstructions(destinationEffect) : 0;
-    return skipCount;
+
+    Code::Region function;
+    if (functionWithHoistedBoundsCheck(basicBlock.start(), function)) {
+        // This block wasn't checked itself, but every jump back to the start of the function is at the entry height
+        canSkipBoundsCheck = BoundsCheckElimination && (size_t)destination == function.start();
+    }
+
+    if (!canSkipBoundsCheck) {
+        return 0;
+    }
+
+    // The destination expects the stack pointer register to have been moved by its bounds check
+    auto stackPointerOffset = BoundsCheckCodeGenerator::stackPointerOffsetAfterCheck(destinationEffect, usesCopyOnWriteAllocator(), m_stackCheckMode);
+    if (stackPointerOffset != 0) {
+        if (!unconditionalBranch) {
+            return 0;
+        }
+        unconditionalBranch->add(ARM::subLargeImm(StackPointerRegister, stackPointerOffset * 4));
+    }
+
+    return BoundsCheckCodeGenerator::numberOfInstructions(destinationEffect, usesCopyOnWriteAllocator(), m_stackCheckMode);
+}
+
+bool Compiler::functionWithHoistedBoundsCheck(size_t index, Code::Region& function)
+{
+    // Functions compiled later could jump into blocks without checks
+    // Computed jumps may enter any block that was made a possible destination
+    if (!FunctionLevelBoundsChecks || m_analysis.hasDynamicCalls() || m_analysis.hasComputedJumps()) {
+        return false;
+    }
+    for (auto region : m_analysis.functionRegions()) {
+        if (region.contains(index) && m_analysis.stackEffectForFunction(region.start()).bounded()) {
+            function = region;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Compiler::stackBoundsProven()
+{
+    return WholeProgramStackBounds && m_hasWholeProgramEntry && !m_analysis.hasDynamicCalls() && !m_analysis.hasComputedJumps() && m_analysis.functionRegions().size() > 0 && m_analysis.stackEffectForFunction(0).bounded();
 }
 
-Compiler::Status Compiler::compileBasicBlockStack(ARM::Functor& func, Code::Region basicBlock, Code::Region functionBlock, std::vector<PCRelativeLoad>& relativeLoads)
+int Compiler::provenMaximumStackDepth()
 {
-    auto stackEffect = m_analysis.stackEffectForBasicBlock(basicBlock);
+    return stackBoundsProven() ? m_analysis.stackEffectForFunction(0).pushCount() : -1;
+}
+
+Code::BlockStackEffect Compiler::checkedStackEffectForBasicBlock(Code::Region basicBlock)
+{
+    // The interpreter does its own checks
+    if (stackBoundsProven() || isInterpretedFunction(basicBlock.start())) {
+        return Code::BlockStackEffect(0, 0, 0);
+    }
+
+    Code::Region function;
+    if (functionWithHoistedBoundsCheck(basicBlock.start(), function)) {
+        if (basicBlock.start() == function.start()) {
+            return m_analysis.stackEffectForFunction(function.start()).blockStackEffect();
+        }
+        return Code::BlockStackEffect(0, 0, 0);
+    }
+    return m_analysis.stackEffectForBasicBlock(basicBlock);
+}
+
+RegisterLayout Compiler::entryLayoutForBlock(size_t destination, RegisterLayout proposed)
+{
+    auto existing = m_blockEntryLayouts.find(destination);
+    if (existing != m_blockEntryLayouts.end()) {
+        return existing->second;
+    }
+    // Values below those that the block pops might not exist, so they aren't loaded into registers on entry
+    auto index = m_analysis.blockIndex(destination);
+    auto guaranteed = index == BasicBlockSummary::NoBlock ? 1 : m_analysis.basicBlockTable()[index].m_effect.popCount();
+    if (proposed.m_count > guaranteed) {
+        proposed = RegisterLayout::canonical(guaranteed);
+    }
+    m_blockEntryLayouts[destination] = proposed;
+    return proposed;
+}
+
+bool Compiler::returnToEntryLayout(ARM::Functor& func, RegisterFileState& registerState, Code::Region functionBlock, size_t destination, const ARM::Register* poppedRegisters, int poppedCount)
+{
+    if (!(FunctionLevelRegisterAllocation && usesCopyOnWriteAllocator())) {
+        return registerState.returnToNaiveState(func);
+    }
+
+    auto proposed = RegisterLayout::naive();
+    if (functionBlock.contains(destination) && !m_analysis.isCallDestination(destination) && !m_externallyEnteredBlocks[destination]) {
+        proposed = RegisterLayout::canonical(registerState.numberOfRegistersHoldingValues() - poppedCount);
+    }
+    return registerState.returnToLayout(func, entryLayoutForBlock(destination, proposed), poppedRegisters, poppedCount);
+}
+
+void Compiler::determineExternallyEnteredBlocks(const std::vector<Code::Region>& functions)
+{
+    m_externallyEnteredBlocks.assign(m_source.length() + 1, false);
+    auto& table = m_analysis.basicBlockTable();
+    for (auto function : functions) {
+        size_t count = 0;
+        auto blocks = m_analysis.blocksForFunction(function.start(), count);
+        for (size_t i = 0; blocks && i < count; ++i) {
+            auto successor = blocks[i].m_jumpSuccessor;
+            if (successor != BasicBlockSummary::NoBlock && !function.contains(table[successor].m_start)) {
+                m_externallyEnteredBlocks[table[successor].m_start] = true;
+            }
+            // Computed jumps always leave in the naive state
+            if (m_analysis.isComputedJumpTarget(blocks[i].m_start)) {
+                m_externallyEnteredBlocks[blocks[i].m_start] = true;
+            }
+        }
+    }
+}
+
+Compiler::Status Compiler::compileBasicBlockStack(ARM::Functor& func, Code::Region basicBlock, Code::Region functionBlock)
+{
+    auto stackEffect = checkedStackEffectForBasicBlock(basicBlock);
     const bool functionReturnsViaPop = m_analysis.functionNeedsToPushRegisters(functionBlock.start());
+    const bool carryRegisters = FunctionLevelRegisterAllocation && usesCopyOnWriteAllocator();
+    bool fallsThrough = true;
 
-    m_linker.setLinkOffset(basicBlock.start(), func.length());
+    if (!m_linker.setLinkOffset(basicBlock.start(), func.length())) {
+        return Status::LinkerFailed;
+    }
 
     if (m_analysis.isCallDestination(basicBlock.start()) && functionReturnsViaPop) {
         func.add(ARM::pushMultiple(true, ARM::RegisterList::empty));
     }
 
-    if (StackCheckMode != StackCheck::None) {
-        BoundsCheckCodeGenerator::compile(m_analysis.stackEffectForBasicBlock(basicBlock), func, m_linker);
+    if (m_stackCheckMode != StackCheck::None) {
+        BoundsCheckCodeGenerator::compile(stackEffect, func, m_linker, usesCopyOnWriteAllocator(), m_stackCheckMode);
     }
 
-    std::unique_ptr<RegisterFileState> registerState = RegisterAllocationMode == RegisterAllocation::Stack ? (std::unique_ptr<RegisterFileState>)Support::make_unique<RegisterFileStateDefaultAllocator>() : (std::unique_ptr<RegisterFileState>)Support::make_unique<RegisterFileStateCOWAllocator>();
+    if (!m_registerStateStorage) {
+        m_registerStateStorage = m_arena.allocate(RegisterFileStateStorageSize);
+    }
+    Support::ArenaPtr<RegisterFileState> registerState;
+    switch (m_registerAllocation) {
+    case RegisterAllocation::StackScheduling:
+        registerState.reset(new (m_registerStateStorage) RegisterFileStateSchedulingAllocator());
+        break;
+    case RegisterAllocation::StackWithCopyOnWrite:
+        registerState.reset(new (m_registerStateStorage) RegisterFileStateCOWAllocator());
+        break;
+    default:
+        registerState.reset(new (m_registerStateStorage) RegisterFileStateDefaultAllocator());
+        break;
+    }
+    registerState->setLiteralPool(m_literalPool);
+
+    if (carryRegisters) {
+        registerState->assumeLayout(entryLayoutForBlock(basicBlock.start(), RegisterLayout::naive()));
+    }
+
+    auto stackPointerOffset = BoundsCheckCodeGenerator::stackPointerOffsetAfterCheck(stackEffect, usesCopyOnWriteAllocator(), m_stackCheckMode);
+    if (stackPointerOffset != 0) {
+        registerState->assumeStackPointerOffset(stackPointerOffset);
+    }
 
     for (Code::Iterator iter(m_source, basicBlock); !iter.finished(); ++iter) {
         Compiler::Status status = Status::Success;
 
+        placeLiteralPoolIfNeeded(func);
+
         switch (iter.instruction()) {
         case Code::Instruction::Add:
         case Code::Instruction::Sub:
@@ -536,8 +926,9 @@ Compiler::Status Compiler::compileBasicBlockStack(ARM::Functor& func, Code::Regi
         case Code::Instruction::Eq:
         case Code::Instruction::Ge:
         case Code::Instruction::Gt:
-            if (ConditionalBranchingMode == ConditionalBranchType::FewerBranches && RegisterAllocationMode == RegisterAllocation::StackWithCopyOnWrite && iter.nextArePushAndConditionalJump()) {
-                if (!registerState->returnToComparisonState(func)) {
+            if (ConditionalBranchingMode == ConditionalBranchType::FewerBranches && usesCopyOnWriteAllocator() && iter.nextArePushAndConditionalJump()) {
+                // When carrying registers the operands are left on the stack for the conditional jump to pop
+                if (!carryRegisters && !registerState->returnToComparisonState(func)) {
                     return Status::RegisterAllocationError;
                 }
             } else {
@@ -546,13 +937,32 @@ Compiler::Status Compiler::compileBasicBlockStack(ARM::Functor& func, Code::Regi
             break;
         case Code::Instruction::Div:
         case Code::Instruction::Mod:
+            if (RegisterPreservingHelpers) {
+                status = compileTwoOperandNativeOp(func, *registerState, iter.instruction());
+            } else {
+                status = compileNonNativeOp(func, *registerState, iter.instruction());
+            }
+            break;
+        case Code::Instruction::Size:
+            if (RegisterPreservingHelpers) {
+                if (!registerState->returnToNaiveState(func)) {
+                    return Status::RegisterAllocationError;
+                }
+                compileStackSize(func);
+                func.add(ARM::moveLowToLow(registerState->push(func), TempRegister));
+            } else {
+                status = compileNonNativeOp(func, *registerState, iter.instruction());
+            }
+            break;
         case Code::Instruction::Nrnd:
         case Code::Instruction::Nrot:
-        case Code::Instruction::Size:
         case Code::Instruction::Wait:
             status = compileNonNativeOp(func, *registerState, iter.instruction());
             break;
         case Code::Instruction::Ntuck: {
+            if (!registerState->ensureRegistersHoldValues(1, func)) {
+                return Status::RegisterAllocationError;
+            }
             auto topReg = registerState->readRegister(0);
             auto compiledNtuck = false;
             if (registerState->registerValueIsKnown(topReg)) {
@@ -580,7 +990,7 @@ Compiler::Status Compiler::compileBasicBlockStack(ARM::Functor& func, Code::Regi
         case Code::Instruction::Push8:
         case Code::Instruction::Push16:
             if (iter.currentIsSafePush() && !(iter.hasMoreInstructions() && isJumpOrCall(iter.nextInstruction()))) {
-                status = compileRegisterAllocatedPush(func, *registerState, iter.pushValue(), false, relativeLoads);
+                status = compileRegisterAllocatedPush(func, *registerState, iter.pushValue());
             }
             break;
             break;
@@ -610,17 +1020,26 @@ Compiler::Status Compiler::compileBasicBlockStack(ARM::Functor& func, Code::Regi
             }
             break;
         case Code::Instruction::Fetch: {
+            if (!registerState->ensureRegistersHoldValues(1, func)) {
+                return Status::RegisterAllocationError;
+            }
             registerState->commitRegisterValue(func, 0);
             compileFetch(func, registerState->readRegister(0), registerState->topOfStackWriteBackRegister());
             break;
         }
         case Code::Instruction::Jmp: {
-            if (!registerState->returnToNaiveState(func)) {
-                return Status::RegisterAllocationError;
-            }
             if (iter.lastWasPush()) {
                 auto destination = iter.pushValue();
-                m_linker.addUnconditionalJump(func, destination, skipDistanceForBranch(basicBlock, destination));
+                if (!returnToEntryLayout(func, *registerState, functionBlock, destination, nullptr, 0)) {
+                    return Status::RegisterAllocationError;
+                }
+                auto skipDistance = skipDistanceForBranch(basicBlock, destination, &func);
+                m_linker.addUnconditionalJump(func, destination, skipDistance);
+            } else if (ComputedJumps && !m_analysis.hasUnprovenComputedJumps(functionBlock.start())) {
+                if (!registerState->returnToNaiveState(func)) {
+                    return Status::RegisterAllocationError;
+                }
+                compileComputedJump(func, false);
             } else {
                 printf("Unsupported non-constant jump at %d\n", (int)iter.index());
                 return Status::UnsupportedVariableJump;
@@ -632,8 +1051,16 @@ Compiler::Status Compiler::compileBasicBlockStack(ARM::Functor& func, Code::Regi
                 // Annoyingly it is only possible to eliminate the bounds check of the destination when the branch is taken
                 auto destination = iter.pushValue();
 
-                if (ConditionalBranchingMode == ConditionalBranchType::FewerBranches && RegisterAllocationMode == RegisterAllocation::StackWithCopyOnWrite && iter.twoPrevWasConditionalCheck()) {
+                if (ConditionalBranchingMode == ConditionalBranchType::FewerBranches && usesCopyOnWriteAllocator() && iter.twoPrevWasConditionalCheck()) {
                     auto cmpRegs = registerState->comparisonRegisters();
+                    if (carryRegisters) {
+                        // Stack is a b (top last), which is compared as a OP b
+                        const ARM::Register operandRegisters[] = { TempRegister, TempRegister3 };
+                        if (!returnToEntryLayout(func, *registerState, functionBlock, destination, operandRegisters, 2)) {
+                            return Status::RegisterAllocationError;
+                        }
+                        cmpRegs = std::make_pair(TempRegister3, TempRegister);
+                    }
                     auto cmp = m_source[iter.nPreviousIndex(2)];
                     auto cond = ARM::Condition::eq;
                     switch (cmp) {
@@ -656,12 +1083,23 @@ Compiler::Status Compiler::compileBasicBlockStack(ARM::Functor& func, Code::Regi
                         break;
                     }
                     m_linker.addMinimalBranchConditionalJump(func, destination, skipDistanceForBranch(basicBlock, destination), cond, std::get<0>(cmpRegs), std::get<1>(cmpRegs));
+                } else if (carryRegisters) {
+                    const ARM::Register conditionRegister[] = { TempRegister };
+                    if (!returnToEntryLayout(func, *registerState, functionBlock, destination, conditionRegister, 1)) {
+                        return Status::RegisterAllocationError;
+                    }
+                    m_linker.addMinimalBranchConditionalJump(func, destination, skipDistanceForBranch(basicBlock, destination), ARM::Condition::ne, TempRegister, 0);
                 } else {
                     if (!registerState->returnToNaiveState(func)) {
                         return Status::RegisterAllocationError;
                     }
                     m_linker.addConditionalJump(func, destination, skipDistanceForBranch(basicBlock, destination));
                 }
+            } else if (ComputedJumps && !m_analysis.hasUnprovenComputedJumps(functionBlock.start())) {
+                if (!registerState->returnToNaiveState(func)) {
+                    return Status::RegisterAllocationError;
+                }
+                compileComputedJump(func, true);
             } else {
                 printf("Unsupported non-constant conditional jump at %d\n", (int)iter.index());
                 return Status::UnsupportedVariableJump;
@@ -705,9 +1143,16 @@ Compiler::Status Compiler::compileBasicBlockStack(ARM::Functor& func, Code::Regi
         if (status != Status::Success) {
             return status;
         }
+
+        // A tail call skips over the return, so it is also seen here
+        fallsThrough = !endsWithUnconditionalBranch(iter.instruction());
     }
 
-    if (!registerState->inNaiveState()) {
+    if (carryRegisters) {
+        if (fallsThrough && !returnToEntryLayout(func, *registerState, functionBlock, basicBlock.end(), nullptr, 0)) {
+            return Status::RegisterAllocationError;
+        }
+    } else if (!registerState->inNaiveState()) {
         if (!registerState->returnToNaiveState(func)) {
             return Status::RegisterAllocationError;
         }
@@ -719,18 +1164,49 @@ void Compiler::compileCall(ARM::Functor& func, Code::Iterator& iter, Code::Regio
 {
     if (iter.lastWasPush()) {
         auto destination = iter.pushValue();
-        if (!m_analysis.functionNeedsToPushRegisters(functionBlock.start()) && !m_analysis.functionNeedsToPushRegisters(iter.pushValue()) && iter.hasMoreInstructions() && iter.nextInstruction() == Code::Instruction::Ret) {
-            m_linker.addUnconditionalJump(func, destination, skipDistanceForBranch(basicBlock, destination));
+        // Functions in an earlier segment may be out of range of a branch, but not of a call
+        auto destinationIsSealed = m_linker.hasOffsetForBasicBlock(destination) && func.isSealed(m_linker.offsetForBasicBlock(destination));
+        if (!destinationIsSealed && !m_analysis.functionNeedsToPushRegisters(functionBlock.start()) && !m_analysis.functionNeedsToPushRegisters(iter.pushValue()) && iter.hasMoreInstructions() && iter.nextInstruction() == Code::Instruction::Ret) {
+            auto skipDistance = skipDistanceForBranch(basicBlock, destination, &func);
+            m_linker.addUnconditionalJump(func, destination, skipDistance);
             // Important to skip the return instruction
             ++iter;
         } else {
             m_linker.addCall(func, destination);
         }
+    } else if (InlineCaching) {
+        compileCachedDynamicCall(func);
     } else {
         compileDynamicCall(func);
     }
 }
 
+void Compiler::compileCachedDynamicCall(ARM::Functor& func)
+{
+    // The cached target is loaded from a word aligned literal at a fixed offset
+    if (func.length() % 2 == 1) {
+        func.add(ARM::nop());
+    }
+
+    func.add(ARM::loadWordWithPCOffset(TempRegister, (CachedCallTargetOffset - 2) / 2));
+    func.add(ARM::compareLowRegisters(StackTopRegister, TempRegister));
+    func.add(ARM::conditionalBranch(ARM::Condition::ne, 6)); // To the call to compileFunctionDynamicallyASM
+    func.add(ARM::addSmallImm(StackPointerRegister, StackPointerRegister, 4));
+    func.add(ARM::loadWordWithOffset(StackTopRegister, StackPointerRegister, 0));
+    // Patched to call the function for the cached target. Until then it calls the code below, which undoes the pop.
+    func.add(ARM::branchAndLinkNatural(3));
+    func.add(ARM::unconditionalBranch(7)); // Skips to the end
+
+    // The target was only ever in StackTopRegister, so it is restored from the cached value that it matched
+    func.add(ARM::subSmallImm(StackPointerRegister, StackPointerRegister, 4));
+    func.add(ARM::moveLowToLow(StackTopRegister, TempRegister));
+    m_linker.addHelperCall(func, (Environment::VMFunction)((int)&compileFunctionDynamicallyASM | 0x1));
+    func.add(ARM::unconditionalBranch(2)); // Skips the cached target
+    func.add(ARM::nop());
+    // Matching the initial target is harmless as the initial call goes to the slow path anyway
+    func.addData(-1);
+}
+
 Compiler::Status Compiler::compileOneOperandNativeOp(ARM::Functor& func, RegisterFileState& registerState, Code::Instruction instr)
 {
     if (!registerState.ensureRegistersHoldValues(1, func)) {
@@ -783,6 +1259,18 @@ Compiler::Status Compiler::compileTwoOperandNativeOp(ARM::Functor& func, Registe
     auto top1IsKnown = registerState.registerValueIsKnown(top1);
     auto top2IsKnown = registerState.registerValueIsKnown(top2);
 
+    // Only the divisor of Div and Mod can be the known operand, whereas either operand of Mul can be
+    if (StrengthReduction && top1IsKnown != top2IsKnown && (top1IsKnown || instr == Code::Instruction::Mul)) {
+        auto value = top1IsKnown ? top2 : top1;
+        auto operand = registerState.knownRegisterValue(top1IsKnown ? top1 : top2);
+        if (canStrengthReduce(instr, operand)) {
+            // The known operand is never written to its register
+            registerState.commitRegisterValue(func, value);
+            compileStrengthReducedOp(func, instr, registerState.push(func), value, operand);
+            return Status::Success;
+        }
+    }
+
     if (!(top1IsKnown && top2IsKnown)) {
         registerState.commitRegisterValue(func, top1);
         registerState.commitRegisterValue(func, top2);
@@ -805,10 +1293,10 @@ Compiler::Status Compiler::compileTwoOperandNativeOp(ARM::Functor& func, Registe
             registerState.setKnownRegisterValue(func, dest, top2Value * top1Value);
             break;
         case Code::Instruction::Div:
-            registerState.setKnownRegisterValue(func, dest, top2Value / top1Value);
+            registerState.setKnownRegisterValue(func, dest, divide(top2Value, top1Value));
             break;
         case Code::Instruction::Mod:
-            registerState.setKnownRegisterValue(func, dest, top2Value % top1Value);
+            registerState.setKnownRegisterValue(func, dest, modulo(top2Value, top1Value));
             break;
         case Code::Instruction::Max:
             if (top1Value > top2Value) {
@@ -882,6 +1370,14 @@ Compiler::Status Compiler::compileTwoOperandNativeOp(ARM::Functor& func, Registe
                 func.add(ARM::moveLowToLow(dest, TempRegister));
             }
             break;
+        case Code::Instruction::Div:
+        case Code::Instruction::Mod:
+            // The division routine preserves every register other than TempRegister and HelperOperandRegister
+            func.add(ARM::moveLowToLow(TempRegister, top2));
+            func.add(ARM::moveGeneral(HelperOperandRegister, top1));
+            compileRegisterHelperCall(func);
+            func.add(ARM::moveGeneral(dest, divisionResultRegister(instr)));
+            break;
         case Code::Instruction::Max:
             func.add(ARM::moveLowToLow(TempRegister, top2));
             func.add(ARM::compareLowRegisters(top1, top2));
@@ -940,28 +1436,28 @@ Compiler::Status Compiler::compileNonNativeOp(ARM::Functor& func, RegisterFileSt
     }
     switch (instr) {
     case Code::Instruction::Div:
-        compileCFunctionCall(func, &executeDiv);
+        compileCFunctionCall(func, &executeDiv, true, &m_linker);
         break;
     case Code::Instruction::Mod:
-        compileCFunctionCall(func, &executeMod);
+        compileCFunctionCall(func, &executeMod, true, &m_linker);
         break;
     case Code::Instruction::Min:
-        compileCFunctionCall(func, &executeMin);
+        compileCFunctionCall(func, &executeMin, true, &m_linker);
         break;
     case Code::Instruction::Max:
-        compileCFunctionCall(func, &executeMax);
+        compileCFunctionCall(func, &executeMax, true, &m_linker);
         break;
     case Code::Instruction::Nrnd:
-        compileCFunctionCall(func, m_device->resolveVirtualMachineFunction(Code::Instruction::Nrnd));
+        compileCFunctionCall(func, m_device->resolveVirtualMachineFunction(Code::Instruction::Nrnd), true, &m_linker);
         break;
     case Code::Instruction::Nrot:
-        compileCFunctionCall(func, &executeNrot);
+        compileCFunctionCall(func, &executeNrot, true, &m_linker);
         break;
     case Code::Instruction::Ntuck:
-        compileCFunctionCall(func, &executeNtuck);
+        compileCFunctionCall(func, &executeNtuck, true, &m_linker);
         break;
     case Code::Instruction::Size:
-        compileCFunctionCall(func, &executeSize);
+        compileCFunctionCall(func, &executeSize, true, &m_linker);
         break;
     case Code::Instruction::Wait:
         compileWait(func);
@@ -972,31 +1468,234 @@ Compiler::Status Compiler::compileNonNativeOp(ARM::Functor& func, RegisterFileSt
     return Status::Success;
 }
 
-Compiler::Status Compiler::compileRegisterAllocatedPush(ARM::Functor& func, RegisterFileState& registerState, int value, bool allowPcRelativeLoad, std::vector<PCRelativeLoad>& relativeLoads)
+Compiler::Status Compiler::compileRegisterAllocatedPush(ARM::Functor& func, RegisterFileState& registerState, int value)
 {
     auto dest = registerState.push(func);
     registerState.setKnownRegisterValue(func, dest, value);
     return Status::Success;
 }
 
+Compiler::Status Compiler::compileFunctions(ARM::Functor& func, const std::vector<Code::Region>& functions)
+{
+    auto functionsOffset = func.length();
+    auto linkOperationCount = m_linker.operationCount();
+
+    size_t i = 0;
+    while (i < functions.size()) {
+        auto function = functions[i++];
+        if (isInterpretedFunction(function.start())) {
+            if (!compileInterpretedFunction(func, function)) {
+                return Status::LinkerFailed;
+            }
+            continue;
+        }
+
+        auto functionOffset = func.length();
+        auto functionOperationCount = m_linker.operationCount();
+        auto status = compileFunction(func, function);
+
+        // Conditional jumps start out in their short form, so the function is compiled again with the long form for
+        // any that can't reach their destination. Each attempt grows at least one, so this terminates.
+        while (BranchRelaxation && status == Status::Success && !m_linker.relaxBranches(m_analysis, functionOperationCount)) {
+            func.truncate(functionOffset);
+            m_linker.removeOperationsAfter(functionOperationCount);
+            m_linker.removeLinkOffsets(function);
+            m_blockEntryLayouts.erase(m_blockEntryLayouts.lower_bound(function.start()), m_blockEntryLayouts.lower_bound(function.end()));
+            status = compileFunction(func, function);
+        }
+
+        if (status == Status::Success) {
+            m_peakMemoryUsage.m_codeGenerationBytes = std::max(m_peakMemoryUsage.m_codeGenerationBytes, memoryFootprint(func));
+
+            auto stackCheckMode = m_stackCheckMode;
+            if (m_memoryBudget != 0 && exceedsMemoryBudget(func, functions, i, functionsOffset) && reduceMemoryUsage(functions)) {
+                discardFunctions(func, functions, functionsOffset, linkOperationCount);
+                if (m_stackCheckMode != stackCheckMode) {
+                    // The functions compiled again call the shared checks, which are placed before them
+                    compileStackCheckCallCode(func);
+                    functionsOffset = func.length();
+                    linkOperationCount = m_linker.operationCount();
+                }
+                i = 0;
+            }
+            continue;
+        }
+        if (!InterpreterFallback || (status != Status::UnsupportedVariableJump && status != Status::RegisterAllocationError)) {
+            return status;
+        }
+
+        printf("Function at %d will be interpreted: %s\n", (int)function.start(), statusString(status));
+        m_interpretedFunctions.insert(function.start());
+
+        // Branches to the function that have already been compiled may skip the bounds check at its start, so the
+        // other functions have to be compiled again
+        discardFunctions(func, functions, functionsOffset, linkOperationCount);
+        i = 0;
+    }
+
+    m_hasCompiledFunctions = true;
+    return Status::Success;
+}
+
+void Compiler::discardFunctions(ARM::Functor& func, const std::vector<Code::Region>& functions, size_t functionsOffset, size_t linkOperationCount)
+{
+    func.truncate(functionsOffset);
+    m_linker.removeOperationsAfter(linkOperationCount);
+    for (auto f : functions) {
+        m_linker.removeLinkOffsets(f);
+        m_blockEntryLayouts.erase(m_blockEntryLayouts.lower_bound(f.start()), m_blockEntryLayouts.lower_bound(f.end()));
+    }
+}
+
+size_t Compiler::memoryFootprint(const ARM::Functor& func) const
+{
+    return func.capacity() * sizeof(ARM::Instruction) + m_arena.heapBytes() + m_analysis.memoryFootprint() + m_linker.memoryFootprint();
+}
+
+bool Compiler::exceedsMemoryBudget(const ARM::Functor& func, const std::vector<Code::Region>& functions, size_t nextFunction, size_t functionsOffset) const
+{
+    size_t compiledBytecode = 0;
+    size_t remainingBytecode = 0;
+    for (size_t i = 0; i < functions.size(); ++i) {
+        if (isInterpretedFunction(functions[i].start())) {
+            continue;
+        }
+        if (i < nextFunction) {
+            compiledBytecode += functions[i].length();
+        } else {
+            remainingBytecode += functions[i].length();
+        }
+    }
+    if (compiledBytecode == 0) {
+        return false;
+    }
+
+    // The rest of the functions are assumed to compile to as many instructions per byte of bytecode as those so far
+    auto emittedInstructions = func.length() - functionsOffset;
+    auto projectedLength = func.length() + remainingBytecode * emittedInstructions / compiledBytecode;
+
+    // The buffer of the functor doubles in capacity as it grows, and its old storage is only freed once it has been
+    // copied, so growing to a capacity of n briefly needs 1.5n
+    auto projectedCapacity = func.capacity() > 0 ? func.capacity() : 1;
+    while (projectedCapacity < projectedLength) {
+        projectedCapacity *= 2;
+    }
+    auto projectedCodeBytes = projectedCapacity * sizeof(ARM::Instruction);
+    if (projectedCapacity > func.capacity()) {
+        projectedCodeBytes += projectedCodeBytes / 2;
+    }
+
+    // Most of the arena is taken up by link operations, which also grow with the code
+    auto projectedArenaBytes = m_arena.heapBytes() + m_arena.heapBytes() * remainingBytecode / compiledBytecode;
+
+    auto projectedBytes = projectedCodeBytes + projectedArenaBytes + m_analysis.memoryFootprint() + m_linker.memoryFootprint();
+    return projectedBytes > m_memoryBudget;
+}
+
+bool Compiler::reduceMemoryUsage(const std::vector<Code::Region>& functions)
+{
+    if (m_registerAllocation != RegisterAllocation::Naive) {
+        printf("Memory budget: using the naive register allocator\n");
+        m_registerAllocation = RegisterAllocation::Naive;
+        return true;
+    }
+
+    // Functions compiled earlier would disagree with new ones about which functions push LR
+    if (!m_hasCompiledFunctions && m_stackCheckMode != StackCheck::None && m_stackCheckMode != StackCheck::BoundsCheckByCall) {
+        printf("Memory budget: using shared stack checks\n");
+        m_stackCheckMode = StackCheck::BoundsCheckByCall;
+        m_analysis.setStackCheckMode(m_stackCheckMode);
+        return true;
+    }
+
+    if (!InterpreterFallback) {
+        return false;
+    }
+
+    const Code::Region* largest = nullptr;
+    for (auto& function : functions) {
+        if (!isInterpretedFunction(function.start()) && isColdFunction(function) && (!largest || function.length() > largest->length())) {
+            largest = &function;
+        }
+    }
+    if (!largest) {
+        return false;
+    }
+    printf("Memory budget: function at %d will be interpreted\n", (int)largest->start());
+    m_interpretedFunctions.insert(largest->start());
+    return true;
+}
+
+bool Compiler::isColdFunction(Code::Region function) const
+{
+    for (Code::Iterator iter(m_source, function); !iter.finished(); ++iter) {
+        auto index = iter.index();
+        // The stub for an interpreted function can only be entered at its start
+        if (index != function.start() && (m_externallyEnteredBlocks[index] || m_analysis.isComputedJumpTarget(index))) {
+            return false;
+        }
+        if (isJump(iter.instruction()) && iter.lastWasPush() && (size_t)iter.pushValue() <= index) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Compiler::compileInterpretedFunction(ARM::Functor& func, Code::Region function)
+{
+    if (!m_linker.setLinkOffset(function.start(), func.length())) {
+        return false;
+    }
+    // Called like any other function, but the C call overwrites LR
+    func.add(ARM::pushMultiple(true, ARM::RegisterList::empty));
+    compileLoadConstant(func, (int)function.start(), TempRegister);
+    func.add(ARM::storeWordWithOffset(TempRegister, StatePointerRegister, offsetof(Environment::VM, m_programCounter) / sizeof(uint32_t)));
+    compileCFunctionCall(func, &interpretFunctionForCompiledCode, true, &m_linker);
+
+    // Halt if interpretFunctionForCompiledCode set the program counter to HaltedProgramCounter (-1)
+    func.add(ARM::loadWordWithOffset(TempRegister, StatePointerRegister, offsetof(Environment::VM, m_programCounter) / sizeof(uint32_t)));
+    func.add(ARM::addSmallImm(TempRegister, TempRegister, 1));
+    func.add(ARM::conditionalBranch(ARM::Condition::ne, 1));
+    m_linker.addHalt(func);
+    func.add(ARM::popMultiple(true, ARM::RegisterList::empty));
+    return true;
+}
+
 Compiler::Status Compiler::compileFunction(ARM::Functor& func, Code::Region function)
 {
-    std::vector<PCRelativeLoad> relativeLoads;
-    for (auto basicBlock : m_analysis.basicBlocksForFunction(function)) {
+    LiteralPool literalPool(m_arena);
+    m_literalPool = AllowPCRelativeLoads ? &literalPool : nullptr;
+
+    bool previousBlockFallsThrough = false;
+    for (auto basicBlock : m_analysis.basicBlocksForFunction(function, m_arena)) {
+        // Pools are placed between basic blocks where execution can't reach them if the next block could put them out
+        // of range. Otherwise they are only placed within a block, behind a branch, as a last resort.
+        if (m_literalPool && m_literalPool->needsPlacement(func, basicBlock.length() * MaxArmInstructionsPerStackInstruction + LiteralPoolPlacementMargin)) {
+            if (previousBlockFallsThrough) {
+                m_literalPool->placeWithBranch(func);
+            } else {
+                m_literalPool->place(func);
+            }
+        }
+
         Compiler::Status status;
-        switch (RegisterAllocationMode) {
+        switch (m_registerAllocation) {
         case RegisterAllocation::Naive:
-            status = compileBasicBlockNaive(func, basicBlock, function, relativeLoads);
+            status = compileBasicBlockNaive(func, basicBlock, function);
             break;
         case RegisterAllocation::Stack:
         case RegisterAllocation::StackWithCopyOnWrite:
-            status = compileBasicBlockStack(func, basicBlock, function, relativeLoads);
+        case RegisterAllocation::StackScheduling:
+            status = compileBasicBlockStack(func, basicBlock, function);
             break;
         }
 
         if (status != Status::Success) {
+            m_literalPool = nullptr;
             return status;
         }
+
+        previousBlockFallsThrough = basicBlockFallsThrough(basicBlock);
     }
 
     // The function should have terminated in all code paths by this point, so if not halt because
@@ -1004,19 +1703,28 @@ Compiler::Status Compiler::compileFunction(ARM::Functor& func, Code::Region func
     compileHalt(func);
 
     // Compile the data section for this function
-    if (relativeLoads.size() > 0) {
-        if (func.length() % 2 == 1) {
-            // Data needs to be aligned properly
-            func.add(ARM::nop());
-        }
-        for (PCRelativeLoad& relativeLoad : relativeLoads) {
-            relativeLoad.insertData(func);
-        }
-    }
+    literalPool.place(func);
+    m_literalPool = nullptr;
 
     return Status::Success;
 }
 
+void Compiler::placeLiteralPoolIfNeeded(ARM::Functor& func)
+{
+    if (m_literalPool && m_literalPool->needsPlacement(func, LiteralPoolPlacementMargin)) {
+        m_literalPool->placeWithBranch(func);
+    }
+}
+
+bool Compiler::basicBlockFallsThrough(Code::Region basicBlock)
+{
+    bool fallsThrough = true;
+    for (Code::Iterator iter(m_source, basicBlock); !iter.finished(); ++iter) {
+        fallsThrough = !endsWithUnconditionalBranch(iter.instruction());
+    }
+    return fallsThrough;
+}
+
 Compiler::Status Compiler::compile(ARM::Functor& functor)
 {
     auto status = compileGeneral(functor, 0, true);
@@ -1042,40 +1750,62 @@ Compiler::Status Compiler::compileGeneral(ARM::Functor& functor, int start, bool
     if (AlwaysPrintStaticAnalysis) {
         m_analysis.printStaticAnalyis();
     }
+    m_peakMemoryUsage.m_analysisBytes = std::max(m_peakMemoryUsage.m_analysisBytes, memoryFootprint(functor));
 
     auto status = Status::Success;
 
     auto functions = m_analysis.newFunctionRegions();
 
+    if ((FunctionLevelRegisterAllocation && usesCopyOnWriteAllocator()) || m_memoryBudget != 0) {
+        determineExternallyEnteredBlocks(functions);
+    }
+
     ARM::resetEncodingStatusFlags();
 
     if (compileGlobal) {
+        m_hasWholeProgramEntry = true;
+
         // The halt support stores the LR for the function calling the functor
         // I now always compile halt support in case of error conditions
         compileEntryCode(functor);
 
         // Call the start of Stack code if it exists
         if (functions.size() > 0) {
+            if (m_stackCheckMode != StackCheck::None && stackBoundsProven()) {
+                BoundsCheckCodeGenerator::compile(m_analysis.stackEffectForFunction(0).blockStackEffect(), functor, m_linker, false, m_stackCheckMode);
+            }
             m_linker.addCall(functor, 0);
         }
 
         compileHaltCode(functor);
-        if (StackCheckMode != StackCheck::None) {
-            compileStackOverflowCode(functor);
-            compileStackUnderflowCode(functor);
-        }
+        compileStackCheckErrorCode(functor);
+    } else if (functor.isSealed(0)) {
+        compileSegmentErrorCode(functor);
     }
 
-    for (auto f : functions) {
-        status = compileFunction(functor, f);
-        if (status != Status::Success) {
-            return status;
-        }
+    if (ComputedJumps && m_analysis.hasComputedJumps() && !m_hasComputedJumpCode) {
+        compileComputedJumpCode(functor);
+    }
+
+    if (RegisterPreservingHelpers && !m_hasRegisterHelperCode && functionsUseRegisterHelpers(functions)) {
+        compileRegisterHelperCode(functor);
     }
 
+    status = compileFunctions(functor, functions);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    compileHelperVeneers(functor);
+
+    // The new code may be running when further functions are compiled, so it must not move when they are added
+    functor.seal();
     if (!m_linker.link(functor, m_analysis)) {
         return Status::LinkerFailed;
     }
+    m_peakMemoryUsage.m_linkingBytes = std::max(m_peakMemoryUsage.m_linkingBytes, memoryFootprint(functor));
+    m_registerStateStorage = nullptr;
+    m_arena.reset();
 
     if (!ARM::checkEncodingStatusFlags()) {
         ARM::printEncodingStatusFlags();
@@ -1083,14 +1813,95 @@ Compiler::Status Compiler::compileGeneral(ARM::Functor& functor, int start, bool
     }
 
     functor.commit();
+    attachJumpTable(functor);
 
     return status;
 }
 
+Compiler::Status Compiler::compileIndirectEntry(ARM::Functor& functor)
+{
+    ARM::resetEncodingStatusFlags();
+
+    compileEntryCode(functor);
+    functor.add(ARM::loadWordWithOffset(TempRegister, StatePointerRegister, offsetof(Environment::VM, m_nativeEntryFunction) / sizeof(uint32_t)));
+    functor.add(ARM::branchLinkExchangeToRegister(TempRegister));
+    // Returning normally skips marking the program as halted
+    auto skipBranch = functor.length();
+    functor.add(ARM::nop());
+
+    auto haltOffset = functor.length();
+    compileLoadConstant(functor, HaltedProgramCounter, TempRegister);
+    functor.add(ARM::storeWordWithOffset(TempRegister, StatePointerRegister, offsetof(Environment::VM, m_programCounter) / sizeof(uint32_t)));
+    *functor.address(skipBranch) = ARM::unconditionalBranch((int)functor.length() - (int)skipBranch - 2);
+
+    compileHaltCode(functor);
+    m_linker.setHaltOffset(haltOffset);
+    compileStackCheckErrorCode(functor);
+
+    // Called instead of a function for on-stack replacement. The block may be entered with a register layout other
+    // than the naive one, but only the values that it pops are known to be on the stack, so there is an entry point
+    // for each number of values in the layout that loads no more than that
+    auto layoutCount = FunctionLevelRegisterAllocation && usesCopyOnWriteAllocator() ? NUMBER_OF_BLOCK_BOUNDARY_REGISTERS : 1;
+    for (size_t count = layoutCount; count > 1; --count) {
+        m_onStackReplacementOffsets[count - 1] = functor.length();
+        functor.add(ARM::loadWordWithOffset(BlockBoundaryRegisters[count - 1], StackPointerRegister, count - 1));
+    }
+    m_onStackReplacementOffsets[0] = functor.length();
+    functor.add(ARM::loadWordWithOffset(TempRegister, StatePointerRegister, offsetof(Environment::VM, m_nativeEntryBlock) / sizeof(uint32_t)));
+    functor.add(ARM::branchAndExchange(TempRegister));
+
+    // These are for functions that push LR on entry, as the block jumped to will eventually pop it
+    for (size_t count = 1; count <= layoutCount; ++count) {
+        m_onStackReplacementWithLinkRegisterOffsets[count - 1] = functor.length();
+        functor.add(ARM::pushMultiple(true, ARM::RegisterList::empty));
+        functor.add(ARM::unconditionalBranch((int)m_onStackReplacementOffsets[count - 1] - (int)functor.length() - 2));
+    }
+    m_hasIndirectEntry = true;
+
+    functor.seal();
+    if (!m_linker.link(functor, m_analysis)) {
+        return Status::LinkerFailed;
+    }
+    m_peakMemoryUsage.m_linkingBytes = std::max(m_peakMemoryUsage.m_linkingBytes, memoryFootprint(functor));
+    m_registerStateStorage = nullptr;
+    m_arena.reset();
+
+    if (!ARM::checkEncodingStatusFlags()) {
+        ARM::printEncodingStatusFlags();
+        return Status::InstructionEncodingError;
+    }
+
+    functor.commit();
+    notifyObservers(functor, Status::Success);
+
+    return Status::Success;
+}
+
+Environment::VMFunction Compiler::onStackReplacementEntry(const ARM::Functor& func, int functionStart, int blockStart, Environment::VMFunction& blockEntry)
+{
+    if (!m_hasIndirectEntry || !m_linker.hasOffsetForBasicBlock(functionStart) || !m_linker.hasOffsetForBasicBlock(blockStart)) {
+        return nullptr;
+    }
+
+    // Such a block relies on the bounds check at the start of its function
+    Code::Region function;
+    if (functionWithHoistedBoundsCheck(blockStart, function) && function.start() != (size_t)blockStart) {
+        return nullptr;
+    }
+
+    blockEntry = functionPointerForStackFunction(func, blockStart);
+    // The start of a function pushes LR itself
+    auto pushLinkRegister = blockStart != functionStart && m_analysis.functionNeedsToPushRegisters(functionStart);
+    auto layout = m_blockEntryLayouts.find(blockStart);
+    auto count = FunctionLevelRegisterAllocation && usesCopyOnWriteAllocator() && layout != m_blockEntryLayouts.end() ? layout->second.m_count : 1;
+    auto offset = pushLinkRegister ? m_onStackReplacementWithLinkRegisterOffsets[count - 1] : m_onStackReplacementOffsets[count - 1];
+    return (Environment::VMFunction)((uint32_t)func.address(offset) | 0x1);
+}
+
 Environment::VMFunction Compiler::functionPointerForStackFunction(const ARM::Functor& func, int offset)
 {
     if (m_linker.hasOffsetForBasicBlock(offset)) {
-        return (Environment::VMFunction)((uint32_t)(&func.buffer()[m_linker.offsetForBasicBlock(offset)]) | 0x1);
+        return (Environment::VMFunction)((uint32_t)func.address(m_linker.offsetForBasicBlock(offset)) | 0x1);
     } else {
         return nullptr;
     }
@@ -8,30 +8,52 @@
 #include "Environment/Device.h"
 #include "Environment/VM.h"
 #include "Linker.h"
-#include "PCRelativeLoad.h"
+#include "LiteralPool.h"
 #include "RegisterFileState.h"
 #include "StaticAnalysis.h"
+#include "Support/Arena.h"
 #include <functional>
+#include <map>
+#include <set>
 #include <utility>
 #include <vector>
 
 namespace JIT {
 
+/**
+ * Returned to compileFunctionDynamicallyASM. The code that is running is sealed before it is called, so compiling new
+ * functions never moves it and return addresses on the native stack stay valid.
+ */
 struct DynamicFunctionResult {
     Environment::VM* m_virtualMachinePointer;
     Environment::VMFunction m_functionLocation;
-    int32_t m_newCodeOffset;
 };
 
 DynamicFunctionResult compileFunctionDynamically(Environment::VM* state, int32_t* stackPointer, int32_t topOfStack);
 
+/**
+ * Called by the stubs for InterpreterFallback to interpret the function at the program counter. Sets the program
+ * counter to Compiler::HaltedProgramCounter if the function didn't return, because the program halted or failed.
+ */
+Environment::VM* interpretFunctionForCompiledCode(Environment::VM* state, int32_t* stackPointer, int32_t topOfStack);
+
+/// Used for CompilerMemoryBudget. The most heap memory, in bytes, that the compiler is estimated to use in each phase.
+struct CompilerMemoryUsage {
+    size_t m_analysisBytes = 0;
+    size_t m_codeGenerationBytes = 0;
+    size_t m_linkingBytes = 0;
+};
+
 class Compiler {
 public:
-    Compiler(Code::Array source, Environment::Device* device)
+    Compiler(Code::Array source, Environment::Device* device, RegisterAllocation registerAllocation = RegisterAllocationMode, size_t memoryBudget = CompilerMemoryBudget)
         : m_source(source)
         , m_analysis(source)
         , m_device(device)
-        , m_linker()
+        , m_arena()
+        , m_linker(m_arena)
+        , m_registerAllocation(registerAllocation)
+        , m_memoryBudget(memoryBudget)
     {
     }
 
@@ -57,6 +79,29 @@ public:
      */
     Status compileNewFunction(ARM::Functor& func, int newFunction);
 
+    /**
+     * Used for tiered execution, before any Stack code has been compiled. Compiles entry and halt code that calls the
+     * function in Environment::VM::m_nativeEntryFunction rather than the function at offset 0. If the Stack code
+     * halts then the program counter is set to HaltedProgramCounter, otherwise it is left unchanged.
+     */
+    Status compileIndirectEntry(ARM::Functor& func);
+
+    static const int32_t HaltedProgramCounter = -1;
+
+    /**
+     * Used for on-stack replacement with the entry code from compileIndirectEntry. Returns the function to call
+     * through Environment::VM::m_nativeEntryFunction, with m_nativeEntryBlock set to |blockEntry|, so that the
+     * compiled basic block at |blockStart| runs as if the function at |functionStart| had been called and had then
+     * jumped to it. The stack must be in memory, as for a call. Returns nullptr if this isn't possible.
+     */
+    Environment::VMFunction onStackReplacementEntry(const ARM::Functor& func, int functionStart, int blockStart, Environment::VMFunction& blockEntry);
+
+    /**
+     * Used for ComputedJumps. Fills the jump table of |func| with the address of each basic block that is a possible
+     * destination of a computed jump. This is done after each compilation, but must also be done after deserialising.
+     */
+    void attachJumpTable(ARM::Functor& func);
+
     /**
      * Returns nullptr in the event that the function hasn't been successfully compiled
      */
@@ -69,9 +114,27 @@ public:
      */
     bool hasDynamicCalls() const { return m_analysis.hasDynamicCalls(); }
 
+    /// Used for InterpreterFallback. Returns true if the function at |start| is compiled to a stub that interprets it
+    bool isInterpretedFunction(size_t start) const { return m_interpretedFunctions.find(start) != m_interpretedFunctions.end(); }
+
+    /// Used for InterpreterFallback. Compiles the function at |start| to a stub that interprets it, as if it had failed
+    /// to compile. Must be called before the function is compiled.
+    void interpretFunction(size_t start) { m_interpretedFunctions.insert(start); }
+
+    /**
+     * Used for WholeProgramStackBounds. Returns the maximum number of values that the program pushes above the stack
+     * it is called with, or -1 if this couldn't be proven. Only valid after compilation.
+     */
+    int provenMaximumStackDepth();
+
     using ObserverId = size_t;
     using ObserverFunc = std::function<void(ARM::Functor&, Status)>;
 
+    /// The most memory that the arena for transient compilation data has taken from the heap at once
+    size_t peakArenaBytes() const { return m_arena.peakHeapBytes(); }
+
+    const CompilerMemoryUsage& peakMemoryUsage() const { return m_peakMemoryUsage; }
+
     ObserverId addObserver(ObserverFunc&& observerFunc);
 
     /// Returns true on success
@@ -85,28 +148,148 @@ private:
     StaticAnalysis m_analysis;
 
     const Environment::Device* m_device;
+
+    /// Transient data for the current compilation, which is reset once it has been linked
+    Support::Arena m_arena;
     Linker m_linker;
 
+    /// The storage in m_arena that the register state of each basic block is constructed in
+    void* m_registerStateStorage = nullptr;
+
+    /// Only changed from the allocator that the compiler was created with to fit the memory budget
+    RegisterAllocation m_registerAllocation;
+
+    /// Used for CompilerMemoryBudget, which is the default. Zero if there is no budget.
+    const size_t m_memoryBudget;
+
+    /// Only changed from StackCheckMode to fit the memory budget, before any functions have been compiled
+    StackCheck m_stackCheckMode = StackCheckMode;
+
+    bool m_hasCompiledFunctions = false;
+
+    CompilerMemoryUsage m_peakMemoryUsage;
+
+    /// Whether the entry code calls the function at offset 0, as opposed to compileIndirectEntry
+    bool m_hasWholeProgramEntry = false;
+
+    // Only used with compileIndirectEntry
+    bool m_hasIndirectEntry = false;
+    /// Indexed by the number of values in the entry layout of the block, less one
+    size_t m_onStackReplacementOffsets[NUMBER_OF_BLOCK_BOUNDARY_REGISTERS] = {};
+    size_t m_onStackReplacementWithLinkRegisterOffsets[NUMBER_OF_BLOCK_BOUNDARY_REGISTERS] = {};
+
+    /// Whether the register allocator supports known values, comparison states, and register layouts
+    bool usesCopyOnWriteAllocator() const { return m_registerAllocation == RegisterAllocation::StackWithCopyOnWrite || m_registerAllocation == RegisterAllocation::StackScheduling; }
+
+    // Only used for InterpreterFallback
+    std::set<size_t> m_interpretedFunctions;
+
+    // Only used for ComputedJumps
+    bool m_hasComputedJumpCode = false;
+
+    // Only used for RegisterPreservingHelpers
+    bool m_hasRegisterHelperCode = false;
+
+    /// Used for AllowPCRelativeLoads. The pool of the function being compiled, or null outside of compileFunction
+    LiteralPool* m_literalPool = nullptr;
+
+    // Only used for FunctionLevelRegisterAllocation
+    std::map<size_t, RegisterLayout> m_blockEntryLayouts;
+    std::vector<bool> m_externallyEnteredBlocks;
+
     // Compilation phases
     Status compileGeneral(ARM::Functor& func, int start, bool compileGlobal);
 
+    /**
+     * Compiles each of |functions|, falling back to interpreting those that can't be compiled if InterpreterFallback
+     * is enabled
+     */
+    Status compileFunctions(ARM::Functor& func, const std::vector<Code::Region>& functions);
+
     Status compileFunction(ARM::Functor& func, Code::Region function);
 
+    /// Discards the code compiled for |functions| from |functionsOffset| onwards so that they can be compiled again
+    void discardFunctions(ARM::Functor& func, const std::vector<Code::Region>& functions, size_t functionsOffset, size_t linkOperationCount);
+
+    /// Used for CompilerMemoryBudget. An estimate of the heap memory used by the compiler and |func|.
+    size_t memoryFootprint(const ARM::Functor& func) const;
+
+    /**
+     * Used for CompilerMemoryBudget. Projects the memory needed to compile the rest of |functions|, from
+     * |nextFunction| onwards, from the code emitted since |functionsOffset| for those before it.
+     */
+    bool exceedsMemoryBudget(const ARM::Functor& func, const std::vector<Code::Region>& functions, size_t nextFunction, size_t functionsOffset) const;
+
+    /**
+     * Used for CompilerMemoryBudget. Steps down to a strategy that emits less code: first the naive register
+     * allocator, then StackCheck::BoundsCheckByCall, then interpreting the largest cold function of |functions| each
+     * time. Returns false if there is nothing left to step down to.
+     */
+    bool reduceMemoryUsage(const std::vector<Code::Region>& functions);
+
+    /// Used for CompilerMemoryBudget. Functions without loops are assumed to be cold, and so are left to the interpreter.
+    bool isColdFunction(Code::Region function) const;
+
+    /// Used for InterpreterFallback. Returns false if the function's offsets are too large for the link table.
+    bool compileInterpretedFunction(ARM::Functor& func, Code::Region function);
+
     /**
      * The standard compilation approach that we can always fall back to if a basic block pushes too many values to fit
      * in registers
      */
-    Status compileBasicBlockNaive(ARM::Functor& func, Code::Region basicBlock, Code::Region functionBlock, std::vector<PCRelativeLoad>& relativeLoads);
+    Status compileBasicBlockNaive(ARM::Functor& func, Code::Region basicBlock, Code::Region functionBlock);
 
     /**
      * A smarter approach that pushes into registers whilst it can
      * Currently doesn't aim to do anything with getting lower stack elements into registers
-     *
-     * Note: [deliberately] doesn't yet support PC relative loads
      */
-    Status compileBasicBlockStack(ARM::Functor& func, Code::Region basicBlock, Code::Region functionBlock, std::vector<PCRelativeLoad>& relativeLoads);
+    Status compileBasicBlockStack(ARM::Functor& func, Code::Region basicBlock, Code::Region functionBlock);
+
+    /// Places the literal pool behind a branch if the next instruction could put it out of range
+    void placeLiteralPoolIfNeeded(ARM::Functor& func);
+
+    /// Whether the last instruction of |basicBlock| can continue to the next basic block
+    bool basicBlockFallsThrough(Code::Region basicBlock);
+
+    /**
+     * Returns the number of instructions of the bounds check at |destination| that a branch from |currentBlock| can
+     * skip. If the skipped check would have left the stack pointer register adjusted then this is only possible for
+     * an |unconditionalBranch|, which the adjustment is emitted to.
+     */
+    int skipDistanceForBranch(Code::Region currentBlock, int destination, ARM::Functor* unconditionalBranch = nullptr);
+
+    /**
+     * Used for FunctionLevelBoundsChecks. Returns true and sets |function| if the function containing |index| has a
+     * single bounds check at its entry.
+     */
+    bool functionWithHoistedBoundsCheck(size_t index, Code::Region& function);
 
-    int skipDistanceForBranch(Code::Region currentBlock, int destination);
+    /// Used for WholeProgramStackBounds
+    bool stackBoundsProven();
+
+    /**
+     * The stack effect checked at the start of |basicBlock|, which is empty for blocks whose check was hoisted to the
+     * entry of their function
+     */
+    Code::BlockStackEffect checkedStackEffectForBasicBlock(Code::Region basicBlock);
+
+    /**
+     * Used for FunctionLevelRegisterAllocation. Returns the layout that the block at |destination| is entered with,
+     * fixing it to |proposed| if nothing has fixed it yet. The layout never holds more values than the block pops.
+     */
+    RegisterLayout entryLayoutForBlock(size_t destination, RegisterLayout proposed);
+
+    /**
+     * Emits the code for leaving the current block along an edge to |destination|. This is the naive state unless
+     * FunctionLevelRegisterAllocation is enabled; see RegisterFileState::returnToLayout for |poppedRegisters|.
+     */
+    bool returnToEntryLayout(ARM::Functor& func, RegisterFileState& registerState, Code::Region functionBlock, size_t destination, const ARM::Register* poppedRegisters, int poppedCount);
+
+    /**
+     * Marks blocks that are jumped to from outside of the function they belong to, as these must be entered in the
+     * naive state
+     */
+    void determineExternallyEnteredBlocks(const std::vector<Code::Region>& functions);
 
     /**
      * Used for the register allocation compiler only
@@ -120,20 +303,67 @@ private:
     /**
      * Used only for the register allocation compiler
      */
-    Status compileRegisterAllocatedPush(ARM::Functor& func, RegisterFileState& registerState, int value, bool allowPcRelativeLoad, std::vector<PCRelativeLoad>& relativeLoads);
+    Status compileRegisterAllocatedPush(ARM::Functor& func, RegisterFileState& registerState, int value);
 
     /// Shared between different approaches so that TCO works regardless
     void compileCall(ARM::Functor& func, Code::Iterator& iter, Code::Region thisBasicBlock, Code::Region thisFunctionBlock);
 
+    /**
+     * Used for InlineCaching. Calls the function on top of the stack directly if it is the same as for the last call
+     * from this site, and otherwise goes through compileFunctionDynamicallyASM, which patches the site for the new
+     * function. Expects the naive state.
+     */
+    void compileCachedDynamicCall(ARM::Functor& func);
+
     void compileHalt(ARM::Functor& func);
 
     void compileHaltCode(ARM::Functor& func);
     void compileStackOverflowCode(ARM::Functor& func);
     void compileStackUnderflowCode(ARM::Functor& func);
 
-    void compileRandom(ARM::Functor& func) const;
-    void compileWait(ARM::Functor& func) const;
-    void compileOptional(ARM::Functor& func, Code::Instruction optional, unsigned pushPop) const;
+    /// The code that failed stack checks branch or call to, depending on StackCheckMode
+    void compileStackCheckErrorCode(ARM::Functor& func);
+
+    /**
+     * Functions compiled into a new segment can't rely on reaching the halt and error code in an earlier segment with
+     * a branch, so they get their own copy. The shared stack checks and veneers are called, so are still reachable.
+     */
+    void compileSegmentErrorCode(ARM::Functor& func);
+
+    /**
+     * The shared checks called at the start of each basic block for StackCheck::BoundsCheckByCall, followed by the
+     * same error code as the inline checks
+     */
+    void compileStackCheckCallCode(ARM::Functor& func);
+
+    /// The lookup shared by computed jumps, which expects the destination in TempRegister
+    void compileComputedJumpCode(ARM::Functor& func);
+
+    /// Jumps to the destination on top of the stack, popping the condition as well for CJMP. Expects the naive state.
+    void compileComputedJump(ARM::Functor& func, bool conditional);
+
+    /// The veneer to the division routine shared by Div and Mod, used for RegisterPreservingHelpers
+    void compileRegisterHelperCode(ARM::Functor& func);
+    bool functionsUseRegisterHelpers(const std::vector<Code::Region>& functions);
+
+    /**
+     * Calls the division routine with the dividend in TempRegister and the divisor in HelperOperandRegister, which
+     * leaves the quotient in TempRegister and the remainder in HelperOperandRegister
+     */
+    void compileRegisterHelperCall(ARM::Functor& func);
+
+    /**
+     * Places a veneer for each C function that has been called through the linker since the last compilation, after
+     * the functions that call it
+     */
+    void compileHelperVeneers(ARM::Functor& func);
+
+    /// Used by the naive compiler
+    void compileDivOrMod(ARM::Functor& func, Code::Instruction instr);
+
+    void compileRandom(ARM::Functor& func);
+    void compileWait(ARM::Functor& func);
+    void compileOptional(ARM::Functor& func, Code::Instruction optional, unsigned pushPop);
 
     using Observer = std::pair<ObserverId, std::function<void(ARM::Functor&, Status)>>;
 
@@ -0,0 +1,202 @@
+#include "ComputedJumpTargets.h"
+
+#include "Bit/Bit.h"
+#include "Code/InstructionStackEffect.h"
+#include "Code/Iterator.h"
+#include <algorithm>
+#include <iterator>
+
+namespace JIT {
+
+/// Any more and a value is treated as unknown, which bounds the number of times that the state of a path can change
+static const size_t MaxConstantsPerValue = 16;
+static const size_t MaxTrackedValues = 16;
+
+ComputedJumpTargets::Value ComputedJumpTargets::State::pop()
+{
+    if (m_values.empty()) {
+        return Value();
+    }
+    auto value = m_values.back();
+    m_values.pop_back();
+    return value;
+}
+
+void ComputedJumpTargets::State::push(const Value& value)
+{
+    m_values.push_back(value);
+    if (m_values.size() > MaxTrackedValues) {
+        m_values.erase(m_values.begin());
+    }
+    // Unknown values at the bottom are implied, so each state has a single representation
+    while (!m_values.empty() && !m_values.front().known()) {
+        m_values.erase(m_values.begin());
+    }
+}
+
+ComputedJumpTargets::Value ComputedJumpTargets::join(const Value& x, const Value& y)
+{
+    Value joined;
+    if (x.known() && y.known()) {
+        std::set_union(x.m_constants.begin(), x.m_constants.end(), y.m_constants.begin(), y.m_constants.end(), std::back_inserter(joined.m_constants));
+        if (joined.m_constants.size() > MaxConstantsPerValue) {
+            joined.m_constants.clear();
+        }
+    }
+    return joined;
+}
+
+ComputedJumpTargets::State ComputedJumpTargets::join(const State& x, const State& y)
+{
+    State joined;
+    auto count = std::min(x.m_values.size(), y.m_values.size());
+    auto xBottom = x.m_values.size() - count;
+    auto yBottom = y.m_values.size() - count;
+    for (size_t i = 0; i < count; ++i) {
+        joined.push(join(x.m_values[xBottom + i], y.m_values[yBottom + i]));
+    }
+    return joined;
+}
+
+void ComputedJumpTargets::addSuccessor(size_t offset, const State& state)
+{
+    auto existing = m_entryStates.find(offset);
+    if (existing == m_entryStates.end()) {
+        m_entryStates[offset] = state;
+    } else {
+        auto joined = join(existing->second, state);
+        if (joined == existing->second) {
+            return;
+        }
+        existing->second = joined;
+    }
+    m_worklist.push_back(offset);
+}
+
+bool ComputedJumpTargets::followPath(size_t offset, std::vector<size_t>& targets)
+{
+    auto state = m_entryStates[offset];
+    Code::Iterator iter(m_source, Code::Region(offset, m_source.length() - offset));
+    for (; !iter.finished(); ++iter) {
+        auto instr = iter.instruction();
+        switch (instr) {
+        case Code::Instruction::Push8:
+        case Code::Instruction::Push16:
+            if (!iter.currentIsSafePush()) {
+                return true;
+            }
+            state.push(Value{ { iter.pushValue() } });
+            break;
+        case Code::Instruction::Dup: {
+            auto top = state.pop();
+            state.push(top);
+            state.push(top);
+            break;
+        }
+        case Code::Instruction::Swap: {
+            auto top = state.pop();
+            auto second = state.pop();
+            state.push(top);
+            state.push(second);
+            break;
+        }
+        case Code::Instruction::Rot: {
+            // The third value moves to the top
+            auto top = state.pop();
+            auto second = state.pop();
+            auto third = state.pop();
+            state.push(second);
+            state.push(top);
+            state.push(third);
+            break;
+        }
+        case Code::Instruction::Tuck: {
+            // The top value moves to third
+            auto top = state.pop();
+            auto second = state.pop();
+            auto third = state.pop();
+            state.push(top);
+            state.push(third);
+            state.push(second);
+            break;
+        }
+        case Code::Instruction::Ndup:
+        case Code::Instruction::Nrot:
+        case Code::Instruction::Ntuck:
+        case Code::Instruction::Call:
+            // Each of these could change any value on the stack
+            state.clear();
+            break;
+        case Code::Instruction::Jmp:
+        case Code::Instruction::Cjmp: {
+            auto destination = state.pop();
+            if (instr == Code::Instruction::Cjmp) {
+                state.pop();
+            }
+            bool computed = !iter.lastWasPush() || any(m_metadata[iter.index()] & InstructionMetadata::BasicBlockStart);
+            bool proven = !computed || destination.known();
+            for (auto constant : destination.m_constants) {
+                if (constant < 0 || (size_t)constant >= m_source.length()) {
+                    proven = proven && !computed;
+                    continue;
+                }
+                if (computed) {
+                    targets.push_back((size_t)constant);
+                }
+                addSuccessor((size_t)constant, state);
+            }
+            if (instr == Code::Instruction::Cjmp && iter.nextIndex() < m_source.length()) {
+                addSuccessor(iter.nextIndex(), state);
+            }
+            return proven;
+        }
+        case Code::Instruction::Ret:
+        case Code::Instruction::Halt:
+            return true;
+        default: {
+            if (Code::isOptional(instr)) {
+                if (!iter.currentIsOptional()) {
+                    return true;
+                }
+                auto effect = (unsigned)m_source[iter.index() + 1];
+                for (unsigned i = 0; i < Bit::uintRegion(effect, 0, 4); ++i) {
+                    state.pop();
+                }
+                for (unsigned i = 0; i < Bit::uintRegion(effect, 4, 4); ++i) {
+                    state.push(Value());
+                }
+                break;
+            }
+            Code::InstructionStackEffect effect(instr);
+            if (!effect.deterministicPops()) {
+                // The interpreter stops at instructions that it doesn't recognise
+                return true;
+            }
+            for (int i = 0; i < effect.popCount(); ++i) {
+                state.pop();
+            }
+            for (int i = 0; i < effect.pushCount(); ++i) {
+                state.push(Value());
+            }
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+bool ComputedJumpTargets::find(size_t functionStart, std::vector<size_t>& targets)
+{
+    m_entryStates.clear();
+    m_worklist.clear();
+    addSuccessor(functionStart, State());
+
+    bool proven = true;
+    while (!m_worklist.empty()) {
+        auto offset = m_worklist.back();
+        m_worklist.pop_back();
+        proven = followPath(offset, targets) && proven;
+    }
+    return proven;
+}
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Config.h"
+
+#include "Code/Array.h"
+#include "InstructionMetadata.h"
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace JIT {
+
+/**
+ * Used for ComputedJumps. Finds the destinations of the jumps in a function whose destination isn't the preceding push
+ * by following the constants that it pushes through the stack. Each value on the stack is either one of a small set of
+ * constants or unknown, and the states of the paths that reach the same instruction are merged until they stop
+ * changing. Arithmetic, calls and instructions that move an unknown number of values make values unknown.
+ *
+ * A jump whose destination is unknown, such as an index into a table of equally sized cases, can't be compiled to a
+ * lookup of the destination, as it could reach code that the static analysis never found.
+ */
+class ComputedJumpTargets {
+private:
+    /// A value with no constants is unknown
+    struct Value {
+        std::vector<int> m_constants;
+
+        bool known() const { return !m_constants.empty(); }
+        bool operator==(const Value& other) const { return m_constants == other.m_constants; }
+    };
+
+    /// The values nearest the top of the stack, with the top at the back. Every value below them is unknown.
+    struct State {
+        std::vector<Value> m_values;
+
+        Value pop();
+        void push(const Value& value);
+        void clear() { m_values.clear(); }
+        bool operator==(const State& other) const { return m_values == other.m_values; }
+    };
+
+    Code::Array m_source;
+    const std::vector<InstructionMetadata>& m_metadata;
+    std::map<size_t, State> m_entryStates;
+    std::vector<size_t> m_worklist;
+
+    static Value join(const Value& x, const Value& y);
+    static State join(const State& x, const State& y);
+
+    void addSuccessor(size_t offset, const State& state);
+
+    /// Follows the path from |offset| until it leaves the straight line code. Returns false if a computed jump's
+    /// destination is unknown or outside the code.
+    bool followPath(size_t offset, std::vector<size_t>& targets);
+
+public:
+    /// A jump that starts a basic block in |metadata| is compiled as a computed jump, even if it follows a push
+    ComputedJumpTargets(Code::Array source, const std::vector<InstructionMetadata>& metadata)
+        : m_source(source)
+        , m_metadata(metadata)
+    {
+    }
+
+    /**
+     * Adds the destination of each computed jump reachable from |functionStart| to |targets|, which may have
+     * duplicates. Returns false if any of them can't be proven to be one of the constants that the function pushes.
+     */
+    bool find(size_t functionStart, std::vector<size_t>& targets);
+};
+}
\ No newline at end of file
@@ -6,33 +6,44 @@ namespace JIT {
 
 size_t ConditionalBranch::instructionCount()
 {
-    return 6;
+    return m_isLong ? 6 : 5;
+}
+
+bool ConditionalBranch::shortFormReaches(size_t realDestinationOffset)
+{
+    int offsetFromFourthInstruction = (int)realDestinationOffset - (insertionOffset() + 4) - 2;
+    return offsetFromFourthInstruction >= -128 && offsetFromFourthInstruction <= 127;
 }
 
 bool ConditionalBranch::linkStackCode(ARM::Functor& func, size_t realDestinationOffset)
 {
     size_t i = insertionOffset();
-    uint16_t* buffer = func.buffer();
+    uint16_t* buffer = func.address(i);
 
-    buffer[i] = ARM::moveLowToLow(TempRegister, StackTopRegister);
-    buffer[i + 1] = ARM::addSmallImm(StackPointerRegister, StackPointerRegister, 4);
-    buffer[i + 2] = ARM::loadWordWithOffset(StackTopRegister, StackPointerRegister, 0);
-    buffer[i + 3] = ARM::compareImmediate(TempRegister, 0);
+    buffer[0] = ARM::moveLowToLow(TempRegister, StackTopRegister);
+    buffer[1] = ARM::addSmallImm(StackPointerRegister, StackPointerRegister, 4);
+    buffer[2] = ARM::loadWordWithOffset(StackTopRegister, StackPointerRegister, 0);
+    buffer[3] = ARM::compareImmediate(TempRegister, 0);
 
     // -2 because awkward
-    int offsetFromFourthInstruction = (int)realDestinationOffset - (i + 4) - 2;
+    int offsetFromFourthInstruction = func.distance(i + 4, realDestinationOffset) - 2;
     if (offsetFromFourthInstruction < -128 || offsetFromFourthInstruction > 127) {
-        int offsetFromFifthInstruction = (int)realDestinationOffset - (i + 5) - 2;
+        if (!m_isLong) {
+            return false;
+        }
+        int offsetFromFifthInstruction = func.distance(i + 5, realDestinationOffset) - 2;
         if (offsetFromFifthInstruction < -1024 || offsetFromFifthInstruction > 1023) {
             // TODO Come up with a better strategy for handling this case
             return false;
         } else {
-            buffer[i + 4] = ARM::conditionalBranch(ARM::Condition::eq, 0);
-            buffer[i + 5] = ARM::unconditionalBranch(offsetFromFifthInstruction);
+            buffer[4] = ARM::conditionalBranch(ARM::Condition::eq, 0);
+            buffer[5] = ARM::unconditionalBranch(offsetFromFifthInstruction);
         }
     } else {
-        buffer[i + 4] = ARM::conditionalBranch(ARM::Condition::ne, offsetFromFourthInstruction);
-        buffer[i + 5] = ARM::nop();
+        buffer[4] = ARM::conditionalBranch(ARM::Condition::ne, offsetFromFourthInstruction);
+        if (m_isLong) {
+            buffer[5] = ARM::nop();
+        }
     }
     return true;
 }
@@ -9,13 +9,20 @@ namespace JIT {
  * or the 'dumb' stack allocation one, i.e. not the COW allocator
  */
 class ConditionalBranch : public StackLinkOperation {
+private:
+    /// Whether there is space for a conditional branch over an unconditional branch, rather than just the former
+    bool m_isLong;
+
 public:
-    ConditionalBranch(size_t startOffset, size_t to, int skipCount)
+    ConditionalBranch(size_t startOffset, size_t to, int skipCount, bool isLong = true)
         : StackLinkOperation(startOffset, to, skipCount)
+        , m_isLong(isLong)
     {
     }
 
     size_t instructionCount() final;
     bool linkStackCode(ARM::Functor& func, size_t realDestinationOffset) final;
+    bool isShort() final { return !m_isLong; }
+    bool shortFormReaches(size_t realDestinationOffset) final;
 };
 }
\ No newline at end of file
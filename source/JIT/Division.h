@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Environment/VM.h"
+
+extern "C" {
+/**
+ * This function is implemented in ASM and doesn't follow the C calling convention, so it can only be called from
+ * compiled code: the dividend is passed in r3 and the divisor in ip, and the quotient is returned in r3 and the
+ * remainder in ip. All other registers are preserved.
+ */
+void divideAndModuloASM();
+}
\ No newline at end of file
@@ -0,0 +1,292 @@
+.section .text
+.global divideAndModuloASM
+
+@ Signed division for the JIT, which can't use a divide instruction on the Cortex-M0. The dividend is in r3 and the
+@ divisor in ip. On return the quotient is in r3 and the remainder in ip, and every other register is preserved.
+@ Matches JIT::divide and JIT::modulo, including for a zero divisor (the quotient is 0 and the remainder is the
+@ dividend) and for dividing the smallest integer by -1 (the quotient wraps).
+divideAndModuloASM:
+    push {r0, r1, r2, r4, r5}
+    @ r5 := dividend, whose sign the remainder takes
+    mov r5, r3
+    @ r1 := divisor
+    mov r1, ip
+    cmp r1, #0
+    bne lDivisorNonZero
+    mov r3, #0
+    mov ip, r5
+    pop {r0, r1, r2, r4, r5}
+    bx lr
+lDivisorNonZero:
+    @ r4 := dividend ^ divisor, whose sign the quotient takes
+    mov r4, r5
+    eor r4, r1
+    @ r0 := |dividend|, r1 := |divisor|. The absolute value of the smallest integer is still correct as unsigned.
+    mov r0, r5
+    cmp r0, #0
+    bge lDividendPositive
+    neg r0, r0
+lDividendPositive:
+    cmp r1, #0
+    bgt lDivisorPositive
+    neg r1, r1
+lDivisorPositive:
+    @ r2 := quotient, which each step shifts left and adds the carry of its comparison to
+    mov r2, #0
+    @ Skip the steps for quotient bits that must be zero, so small quotients exit early. Each step that is skipped
+    @ would have compared (|dividend| >> n) with |divisor| and found it smaller. The conditional branches can't reach
+    @ far enough, so they skip unconditional ones instead.
+    lsr r3, r0, #4
+    cmp r3, r1
+    bhs lQuotientAtLeast16
+    b lQuotientBelow16
+lQuotientAtLeast16:
+    lsr r3, r0, #8
+    cmp r3, r1
+    bhs lQuotientAtLeast256
+    b lQuotientBelow256
+lQuotientAtLeast256:
+    lsr r3, r0, #16
+    cmp r3, r1
+    bhs lQuotientAtLeast65536
+    b lQuotientBelow65536
+lQuotientAtLeast65536:
+    @ Each step subtracts |divisor| << n from the remainder if it fits, which leaves the carry set
+    lsr r3, r0, #31
+    cmp r3, r1
+    blo lDivideStep31
+    lsl r3, r1, #31
+    sub r0, r0, r3
+lDivideStep31:
+    adc r2, r2
+    lsr r3, r0, #30
+    cmp r3, r1
+    blo lDivideStep30
+    lsl r3, r1, #30
+    sub r0, r0, r3
+lDivideStep30:
+    adc r2, r2
+    lsr r3, r0, #29
+    cmp r3, r1
+    blo lDivideStep29
+    lsl r3, r1, #29
+    sub r0, r0, r3
+lDivideStep29:
+    adc r2, r2
+    lsr r3, r0, #28
+    cmp r3, r1
+    blo lDivideStep28
+    lsl r3, r1, #28
+    sub r0, r0, r3
+lDivideStep28:
+    adc r2, r2
+    lsr r3, r0, #27
+    cmp r3, r1
+    blo lDivideStep27
+    lsl r3, r1, #27
+    sub r0, r0, r3
+lDivideStep27:
+    adc r2, r2
+    lsr r3, r0, #26
+    cmp r3, r1
+    blo lDivideStep26
+    lsl r3, r1, #26
+    sub r0, r0, r3
+lDivideStep26:
+    adc r2, r2
+    lsr r3, r0, #25
+    cmp r3, r1
+    blo lDivideStep25
+    lsl r3, r1, #25
+    sub r0, r0, r3
+lDivideStep25:
+    adc r2, r2
+    lsr r3, r0, #24
+    cmp r3, r1
+    blo lDivideStep24
+    lsl r3, r1, #24
+    sub r0, r0, r3
+lDivideStep24:
+    adc r2, r2
+    lsr r3, r0, #23
+    cmp r3, r1
+    blo lDivideStep23
+    lsl r3, r1, #23
+    sub r0, r0, r3
+lDivideStep23:
+    adc r2, r2
+    lsr r3, r0, #22
+    cmp r3, r1
+    blo lDivideStep22
+    lsl r3, r1, #22
+    sub r0, r0, r3
+lDivideStep22:
+    adc r2, r2
+    lsr r3, r0, #21
+    cmp r3, r1
+    blo lDivideStep21
+    lsl r3, r1, #21
+    sub r0, r0, r3
+lDivideStep21:
+    adc r2, r2
+    lsr r3, r0, #20
+    cmp r3, r1
+    blo lDivideStep20
+    lsl r3, r1, #20
+    sub r0, r0, r3
+lDivideStep20:
+    adc r2, r2
+    lsr r3, r0, #19
+    cmp r3, r1
+    blo lDivideStep19
+    lsl r3, r1, #19
+    sub r0, r0, r3
+lDivideStep19:
+    adc r2, r2
+    lsr r3, r0, #18
+    cmp r3, r1
+    blo lDivideStep18
+    lsl r3, r1, #18
+    sub r0, r0, r3
+lDivideStep18:
+    adc r2, r2
+    lsr r3, r0, #17
+    cmp r3, r1
+    blo lDivideStep17
+    lsl r3, r1, #17
+    sub r0, r0, r3
+lDivideStep17:
+    adc r2, r2
+    lsr r3, r0, #16
+    cmp r3, r1
+    blo lDivideStep16
+    lsl r3, r1, #16
+    sub r0, r0, r3
+lDivideStep16:
+    adc r2, r2
+lQuotientBelow65536:
+    lsr r3, r0, #15
+    cmp r3, r1
+    blo lDivideStep15
+    lsl r3, r1, #15
+    sub r0, r0, r3
+lDivideStep15:
+    adc r2, r2
+    lsr r3, r0, #14
+    cmp r3, r1
+    blo lDivideStep14
+    lsl r3, r1, #14
+    sub r0, r0, r3
+lDivideStep14:
+    adc r2, r2
+    lsr r3, r0, #13
+    cmp r3, r1
+    blo lDivideStep13
+    lsl r3, r1, #13
+    sub r0, r0, r3
+lDivideStep13:
+    adc r2, r2
+    lsr r3, r0, #12
+    cmp r3, r1
+    blo lDivideStep12
+    lsl r3, r1, #12
+    sub r0, r0, r3
+lDivideStep12:
+    adc r2, r2
+    lsr r3, r0, #11
+    cmp r3, r1
+    blo lDivideStep11
+    lsl r3, r1, #11
+    sub r0, r0, r3
+lDivideStep11:
+    adc r2, r2
+    lsr r3, r0, #10
+    cmp r3, r1
+    blo lDivideStep10
+    lsl r3, r1, #10
+    sub r0, r0, r3
+lDivideStep10:
+    adc r2, r2
+    lsr r3, r0, #9
+    cmp r3, r1
+    blo lDivideStep9
+    lsl r3, r1, #9
+    sub r0, r0, r3
+lDivideStep9:
+    adc r2, r2
+    lsr r3, r0, #8
+    cmp r3, r1
+    blo lDivideStep8
+    lsl r3, r1, #8
+    sub r0, r0, r3
+lDivideStep8:
+    adc r2, r2
+lQuotientBelow256:
+    lsr r3, r0, #7
+    cmp r3, r1
+    blo lDivideStep7
+    lsl r3, r1, #7
+    sub r0, r0, r3
+lDivideStep7:
+    adc r2, r2
+    lsr r3, r0, #6
+    cmp r3, r1
+    blo lDivideStep6
+    lsl r3, r1, #6
+    sub r0, r0, r3
+lDivideStep6:
+    adc r2, r2
+    lsr r3, r0, #5
+    cmp r3, r1
+    blo lDivideStep5
+    lsl r3, r1, #5
+    sub r0, r0, r3
+lDivideStep5:
+    adc r2, r2
+    lsr r3, r0, #4
+    cmp r3, r1
+    blo lDivideStep4
+    lsl r3, r1, #4
+    sub r0, r0, r3
+lDivideStep4:
+    adc r2, r2
+lQuotientBelow16:
+    lsr r3, r0, #3
+    cmp r3, r1
+    blo lDivideStep3
+    lsl r3, r1, #3
+    sub r0, r0, r3
+lDivideStep3:
+    adc r2, r2
+    lsr r3, r0, #2
+    cmp r3, r1
+    blo lDivideStep2
+    lsl r3, r1, #2
+    sub r0, r0, r3
+lDivideStep2:
+    adc r2, r2
+    lsr r3, r0, #1
+    cmp r3, r1
+    blo lDivideStep1
+    lsl r3, r1, #1
+    sub r0, r0, r3
+lDivideStep1:
+    adc r2, r2
+    cmp r0, r1
+    blo lDivideStep0
+    sub r0, r0, r1
+lDivideStep0:
+    adc r2, r2
+    @ Apply the signs
+    cmp r4, #0
+    bge lQuotientPositive
+    neg r2, r2
+lQuotientPositive:
+    cmp r5, #0
+    bge lRemainderPositive
+    neg r0, r0
+lRemainderPositive:
+    mov r3, r2
+    mov ip, r0
+    pop {r0, r1, r2, r4, r5}
+    bx lr
\ No newline at end of file
@@ -7,8 +7,13 @@ compileFunctionDynamicallyASM:
     @ We only use r3 (TempRegister) and r4 (TempRegister2)
     @ As we are making non-tail function calls we have to push LR
     push {r3, r4, lr}
+    @ Remember the call site so that it can be patched for InlineCaching
+    @ 14 == offsetof(Environment::VM, m_dynamicCallReturnAddress) / sizeof(uint32_t)
+    mov r4, lr
+    str r4, [r0, #14 * 4]
     mov r5, r0
-    @ Allocate space on the stack for the DynamicFunctionResult, which is 3 words
+    @ Allocate space on the stack for the DynamicFunctionResult, which is 2 words, plus a word of padding to keep the
+    @ stack 8-byte aligned for the call
     sub sp, #3 * 4
     @ When calling a function that returns a struct the first argument is the address to write the result at
     @ We therefore have to shift the original three arguments along one register
@@ -33,35 +38,10 @@ compileFunctionDynamicallyASM:
     beq lError
     @ We popped it into a temporary, so now move to ip
     mov ip, r3
-    @ This is the offset that we need to add to all the return addresses
-    pop {r3}
-    @ We can skip the loop if the offset is zero
-    cmp r3, r4
-    beq lEnd
-    @ MAIN LOOP
-    @ Invariant: r1 contains the end index (m_escapeStackAddress)
-    @            r4 contains the current index
-    @            r2 contains the current value
-    @            r3 contains the offset that we are adding to the return addresses
-    ldr r1, [r0, #6 * 4]
-    @ r1 w
-    @ r4 is the stack index that we need to modify
-    @ #2 because we ignore r3, r4 pushed onto the stack and we may need to update our own lr!
-    add r4, sp, #2 * 4
-lCheck:
-    @ Terminate the loop once we've checked all the return addresses we need to
-    cmp r1, r4
-    beq lEnd
-    @ Load the value
-    ldr r2, [r4, #0 * 4]
-    @ Adjust the return address by the new offset
-    add r2, r2, r3
-    @ Store the result back to the stack
-    str r2, [r4, #0 * 4]
-    @ Increment the return address that we're looking at
-    add r4, r4, #4
-    b lCheck
-lEnd:
+    @ Discard the padding word
+    add sp, #1 * 4
+    @ Existing code never moves when functions are compiled (it is sealed before it is called), so the return addresses
+    @ on the stack are still valid
     @ Restore registers
     pop {r3, r4}
     @ Restore the lr
@@ -0,0 +1,22 @@
+#include "HelperCall.h"
+
+namespace JIT {
+
+size_t HelperCall::instructionCount()
+{
+    return 2;
+}
+
+bool HelperCall::link(ARM::Functor& func, const StaticAnalysis& analysis, const LinkTable& jumpOffsets, const SpecialLinkerLocations& specialLocations)
+{
+    auto veneer = specialLocations.m_helperVeneers.find(m_helper);
+    if (veneer == specialLocations.m_helperVeneers.end()) {
+        return false;
+    }
+    int i = insertionOffset();
+    auto pair = ARM::branchAndLinkNatural(func.distance(i, veneer->second));
+    func.address(i)[0] = pair.instruction1;
+    func.address(i)[1] = pair.instruction2;
+    return true;
+}
+}
\ No newline at end of file
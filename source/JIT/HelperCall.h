@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Config.h"
+
+#include "Environment/VM.h"
+#include "LinkOperation.h"
+
+namespace JIT {
+
+/**
+ * A BL to the veneer shared by every call to |helper|, which the compiler places after the functions that use it
+ */
+class HelperCall : public LinkOperation {
+private:
+    Environment::VMFunction m_helper;
+
+public:
+    HelperCall(size_t insertionIndex, Environment::VMFunction helper)
+        : LinkOperation(insertionIndex)
+        , m_helper(helper)
+    {
+    }
+
+    size_t instructionCount() final;
+    bool link(ARM::Functor& func, const StaticAnalysis& analysis, const LinkTable& jumpOffsets, const SpecialLinkerLocations& specialLocations) final;
+};
+}
\ No newline at end of file
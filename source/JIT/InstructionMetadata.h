@@ -18,6 +18,12 @@ enum class InstructionMetadata : uint8_t {
      * Denotes that we haven't examined this instruction during static analysis
      */
     Nothing = 0,
+    /**
+     * A possible destination of a jump whose destination isn't a constant, see ComputedJumps
+     *
+     * ComputedJumpTarget => BasicBlockStart
+     */
+    ComputedJumpTarget = 1 << 0,
     /**
      * Means that we cannot execute it (but they could be treated as data)
      * Used to indicate the one or two instructions following a push or optional instruction
@@ -61,9 +67,9 @@ enum class InstructionMetadata : uint8_t {
     FunctionStart = 1 << 6,
 
     /**
-     * The function does not perform recursion (although tail call recursion is allowed) and 
-     * therefore doesn't need to push or pop the return address
-     * 
+     * The function doesn't overwrite LR, as it only makes tail calls to functions that don't either, and therefore
+     * doesn't need to push or pop the return address. See CallGraph.
+     *
      * NoRecursion => FunctionStart
      */
     NoRecursion = 1 << 7,
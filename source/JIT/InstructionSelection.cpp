@@ -2,7 +2,7 @@
 
 namespace JIT {
 
-bool instructionImplementedWithCall(Code::Instruction instruction)
+bool instructionClobbersLinkRegister(Code::Instruction instruction)
 {
     switch (instruction) {
     case Code::Instruction::Add:
@@ -18,15 +18,22 @@ bool instructionImplementedWithCall(Code::Instruction instruction)
     case Code::Instruction::Drop:
     case Code::Instruction::Dup:
     case Code::Instruction::Ndup:
+    case Code::Instruction::Swap:
     case Code::Instruction::Push8:
     case Code::Instruction::Push16:
+    case Code::Instruction::Fetch:
     case Code::Instruction::Jmp:
     case Code::Instruction::Cjmp:
     case Code::Instruction::Halt:
     case Code::Instruction::Ret:
         return false;
+    case Code::Instruction::Max:
+    case Code::Instruction::Min:
+    case Code::Instruction::Size:
+        return !RegisterPreservingHelpers;
     default:
-        // Conservative assumption: all instructions are implemented in terms of a call
+        // Division, the naive ROT and TUCK, dynamic calls, and optional instructions all call a helper. Also the
+        // conservative assumption for anything else.
         return true;
     }
 }
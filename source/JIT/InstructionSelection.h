@@ -6,5 +6,9 @@
 
 namespace JIT {
 
-bool instructionImplementedWithCall(Code::Instruction instruction);
+/**
+ * Whether the code compiled for |instruction| overwrites LR, i.e. calls a helper with BL or BLX, with any register
+ * allocator. Calls with a constant destination are decided by StaticAnalysis instead.
+ */
+bool instructionClobbersLinkRegister(Code::Instruction instruction);
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "Device/OptionalInstructions.h"
 #include "Environment/Device.h"
 #include "Environment/VM.h"
+#include "TieredExecution.h"
 #include <cstdio>
 
 namespace JIT {
@@ -62,6 +63,17 @@ void doFunc(Environment::VM** state, int32_t** stackPointer, int32_t* topOfStack
 
 Environment::VM* execute(Environment::VM* state, int32_t* stackPointer, int32_t topOfStack)
 {
+    bool returned;
+    return execute(state, stackPointer, topOfStack, returned);
+}
+
+Environment::VM* execute(Environment::VM* state, int32_t* stackPointer, int32_t topOfStack, bool& returned)
+{
+    returned = false;
+
+    // Each call to this function interprets a single Stack function
+    const int32_t functionStart = state->m_programCounter;
+
     while ((size_t)state->m_programCounter != state->m_code.length() && state->m_status == Environment::VMStatus::Success) {
         Code::Instruction current = state->m_code[state->m_programCounter];
         state->m_programCounter = state->m_programCounter + 1;
@@ -179,20 +191,34 @@ Environment::VM* execute(Environment::VM* state, int32_t* stackPointer, int32_t
             topOfStack = state->m_code.decodeSigned16BitValue(state->m_programCounter);
             state->m_programCounter += 2;
             break;
-        case Code::Instruction::Jmp:
+        case Code::Instruction::Jmp: {
             UNDERFLOW_CHECK(1);
+            bool backEdge = topOfStack < state->m_programCounter;
             state->m_programCounter = topOfStack;
             stackPointer++; // Pop
             topOfStack = *stackPointer;
+            if (backEdge && state->m_tieredExecution && state->m_tieredExecution->replaceOnBackEdge(&state, functionStart, &stackPointer, &topOfStack)) {
+                // The native code finished the function, and only leaves the program counter at the end if it halted
+                returned = (size_t)state->m_programCounter != state->m_code.length();
+                return state;
+            }
             break;
-        case Code::Instruction::Cjmp:
+        }
+        case Code::Instruction::Cjmp: {
             UNDERFLOW_CHECK(2);
+            bool backEdge = false;
             if (stackPointer[1]) {
+                backEdge = topOfStack < state->m_programCounter;
                 state->m_programCounter = topOfStack;
             }
             stackPointer += 2; // Pop 2
             topOfStack = *stackPointer;
+            if (backEdge && state->m_tieredExecution && state->m_tieredExecution->replaceOnBackEdge(&state, functionStart, &stackPointer, &topOfStack)) {
+                returned = (size_t)state->m_programCounter != state->m_code.length();
+                return state;
+            }
             break;
+        }
         case Code::Instruction::Fetch: {
             UNDERFLOW_CHECK(1);
             topOfStack = state->m_code.decodeSigned16BitValue(topOfStack);
@@ -201,10 +227,20 @@ Environment::VM* execute(Environment::VM* state, int32_t* stackPointer, int32_t
         case Code::Instruction::Call: {
             UNDERFLOW_CHECK(1);
             int pc = state->m_programCounter;
+            Environment::VMFunction nativeFunction = nullptr;
+            if (state->m_tieredExecution && topOfStack >= 0 && (size_t)topOfStack < state->m_code.length()) {
+                nativeFunction = state->m_tieredExecution->functionForCall(topOfStack);
+            }
             state->m_programCounter = topOfStack;
             stackPointer += 1;
             topOfStack = *stackPointer;
 
+            if (nativeFunction) {
+                state->m_programCounter = pc;
+                state = state->m_tieredExecution->callNative(state, nativeFunction, &stackPointer, &topOfStack);
+                break;
+            }
+
             state = execute(state, stackPointer, topOfStack);
 
             stackPointer = state->m_stack.m_stackPointer;
@@ -221,6 +257,7 @@ Environment::VM* execute(Environment::VM* state, int32_t* stackPointer, int32_t
                 *stackPointer = topOfStack;
             }
             state->m_stack.m_stackPointer = stackPointer;
+            returned = true;
             return state;
             break;
         case Code::Instruction::Wait:
@@ -257,11 +294,31 @@ Environment::VM* execute(Environment::VM* state, int32_t* stackPointer, int32_t
     return state;
 }
 
+int32_t divide(int32_t dividend, int32_t divisor)
+{
+    if (divisor == 0) {
+        return 0;
+    } else if (divisor == -1) {
+        return (int32_t)(0 - (uint32_t)dividend);
+    }
+    return dividend / divisor;
+}
+
+int32_t modulo(int32_t dividend, int32_t divisor)
+{
+    if (divisor == 0) {
+        return dividend;
+    } else if (divisor == -1) {
+        return 0;
+    }
+    return dividend % divisor;
+}
+
 Environment::VM* executeDiv(Environment::VM* state, int32_t* stackPointer, int32_t topOfStack)
 {
     UNDERFLOW_CHECK(2);
     state->m_stack.m_stackPointer = stackPointer + 1; // Pop
-    *(state->m_stack.m_stackPointer) = *(state->m_stack.m_stackPointer) / topOfStack;
+    *(state->m_stack.m_stackPointer) = divide(*(state->m_stack.m_stackPointer), topOfStack);
     return state;
 }
 
@@ -269,7 +326,7 @@ Environment::VM* executeMod(Environment::VM* state, int32_t* stackPointer, int32
 {
     UNDERFLOW_CHECK(2);
     state->m_stack.m_stackPointer = stackPointer + 1; // Pop
-    *(state->m_stack.m_stackPointer) = *(state->m_stack.m_stackPointer) % topOfStack;
+    *(state->m_stack.m_stackPointer) = modulo(*(state->m_stack.m_stackPointer), topOfStack);
     return state;
 }
 
@@ -35,6 +35,13 @@ void setGlobalInterpreterDevice(Environment::Device* device);
  */
 Environment::VM* execute(Environment::VM* state, int32_t* stackPointer, int32_t topOfStack);
 
+/**
+ * Same as the above, but also sets |returned| to true if the function finished with a Ret rather than by halting,
+ * failing or running off the end of the code. The program counter can't tell these apart when the Ret is the last
+ * instruction of the code.
+ */
+Environment::VM* execute(Environment::VM* state, int32_t* stackPointer, int32_t topOfStack, bool& returned);
+
 /**
  * Same as the above but fills the stackPointer and topOfStackParameters for you
  */
@@ -76,6 +83,14 @@ inline Environment::VM* preCheckForStackUnderflow(Environment::VM* state, int32_
  * These functions are used by both the interpreter and the compiler
  */
 
+/**
+ * The arithmetic behind Div and Mod, which divideAndModuloASM matches. Dividing by zero gives a quotient of zero and
+ * leaves the dividend as the remainder, and dividing the smallest integer by -1 wraps around.
+ */
+int32_t divide(int32_t dividend, int32_t divisor);
+
+int32_t modulo(int32_t dividend, int32_t divisor);
+
 Environment::VM* executeDiv(Environment::VM* state, int32_t* stackPointer, int32_t topOfStack);
 
 Environment::VM* executeMod(Environment::VM* state, int32_t* stackPointer, int32_t topOfStack);
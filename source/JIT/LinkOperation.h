@@ -3,10 +3,10 @@
 #include "Config.h"
 
 #include "ARM/Functor.h"
+#include "LinkTable.h"
 #include "SpecialLinkerLocations.h"
 #include "StaticAnalysis.h"
 #include <cstddef>
-#include <map>
 
 namespace JIT {
 
@@ -23,6 +23,8 @@ public:
     {
     }
 
+    virtual ~LinkOperation() {}
+
     size_t insertionOffset() const { return m_location; }
 
     void reserve(ARM::Functor& func);
@@ -32,9 +34,15 @@ public:
      */
     virtual size_t instructionCount() = 0;
 
+    /**
+     * Used for BranchRelaxation. Returns false if the operation can't reach its destination from the space that it
+     * reserved, or the destination isn't known yet.
+     */
+    virtual bool reachesDestination(const StaticAnalysis& analysis, const LinkTable& jumpOffsets, const SpecialLinkerLocations& specialLocations) { return true; }
+
     /**
      * Actually insert the link from the generated code offset to the desination code offset
      */
-    virtual bool link(ARM::Functor& func, const StaticAnalysis& analysis, const std::map<size_t, size_t>& jumpOffsets, const SpecialLinkerLocations& specialLocations) = 0;
+    virtual bool link(ARM::Functor& func, const StaticAnalysis& analysis, const LinkTable& jumpOffsets, const SpecialLinkerLocations& specialLocations) = 0;
 };
 }
\ No newline at end of file
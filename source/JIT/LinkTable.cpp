@@ -0,0 +1,72 @@
+#include "LinkTable.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace JIT {
+
+std::vector<LinkTable::Entry>::const_iterator LinkTable::lowerBound(size_t bytecodeOffset) const
+{
+    return std::lower_bound(m_entries.begin(), m_entries.end(), bytecodeOffset, [](const Entry& entry, size_t offset) {
+        return entry.m_bytecodeOffset < offset;
+    });
+}
+
+bool LinkTable::set(size_t bytecodeOffset, size_t nativeOffset)
+{
+    if (bytecodeOffset > UINT16_MAX || nativeOffset > UINT16_MAX) {
+        printf("WARNING: Link offset %d -> %d doesn't fit in the link table\n", (int)bytecodeOffset, (int)nativeOffset);
+        return false;
+    }
+
+    Entry entry = { (uint16_t)bytecodeOffset, (uint16_t)nativeOffset };
+    // Basic blocks are mostly compiled in order, so this is usually an append
+    if (m_entries.empty() || m_entries.back().m_bytecodeOffset < bytecodeOffset) {
+        m_entries.push_back(entry);
+        return true;
+    }
+    auto iter = m_entries.begin() + (lowerBound(bytecodeOffset) - m_entries.begin());
+    if (iter->m_bytecodeOffset == bytecodeOffset) {
+        *iter = entry;
+    } else {
+        m_entries.insert(iter, entry);
+    }
+    return true;
+}
+
+bool LinkTable::contains(size_t bytecodeOffset) const
+{
+    auto iter = lowerBound(bytecodeOffset);
+    return iter != m_entries.end() && iter->m_bytecodeOffset == bytecodeOffset;
+}
+
+bool LinkTable::find(size_t bytecodeOffset, size_t& nativeOffset) const
+{
+    auto iter = lowerBound(bytecodeOffset);
+    if (iter == m_entries.end() || iter->m_bytecodeOffset != bytecodeOffset) {
+        return false;
+    }
+    nativeOffset = iter->m_nativeOffset;
+    return true;
+}
+
+void LinkTable::remove(Code::Region region)
+{
+    auto first = m_entries.begin() + (lowerBound(region.start()) - m_entries.begin());
+    auto last = m_entries.begin() + (lowerBound(region.end()) - m_entries.begin());
+    m_entries.erase(first, last);
+}
+
+void LinkTable::serialise(Transfer::Serialiser& serialiser) const
+{
+    serialiser.appendUnsignedInt(m_entries.size());
+    serialiser.appendData((const uint8_t*)m_entries.data(), m_entries.size() * sizeof(Entry));
+}
+
+void LinkTable::deserialise(Transfer::Deserialiser& deserialiser)
+{
+    size_t count = deserialiser.readUnsignedInt();
+    m_entries = std::vector<Entry>(count, Entry());
+    deserialiser.readData((uint8_t*)m_entries.data(), count * sizeof(Entry));
+}
+}
\ No newline at end of file
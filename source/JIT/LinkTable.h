@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Config.h"
+
+#include "Code/Region.h"
+#include "Transfer/Deserialiser.h"
+#include "Transfer/Serialiser.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace JIT {
+
+/**
+ * The native offset of each compiled basic block, keyed by the bytecode offset of its first instruction. Entries are
+ * kept sorted in a single array of 16-bit pairs, i.e. 4 bytes per basic block, so that the table can be written to and
+ * read from flash in one go.
+ *
+ * This isn't keyed by StaticAnalysis::blockIndex, although that would make lookups constant time. Block indices depend
+ * on the order in which functions were analysed, and the block table is rebuilt in a different order when the analysis
+ * is read back from flash, so a table keyed by them couldn't be stored with the code. Every lookup also starts from a
+ * bytecode offset, and keeping the entries in bytecode order lets remove discard a function's blocks as one range.
+ */
+class LinkTable {
+private:
+    struct Entry {
+        uint16_t m_bytecodeOffset;
+        uint16_t m_nativeOffset;
+    };
+
+    std::vector<Entry> m_entries;
+
+    /// The first entry whose bytecode offset isn't less than |bytecodeOffset|
+    std::vector<Entry>::const_iterator lowerBound(size_t bytecodeOffset) const;
+
+public:
+    /// Returns false, leaving the table unchanged, if either offset doesn't fit in 16 bits
+    bool set(size_t bytecodeOffset, size_t nativeOffset);
+
+    bool contains(size_t bytecodeOffset) const;
+
+    /// Returns false if the basic block at |bytecodeOffset| hasn't been compiled
+    bool find(size_t bytecodeOffset, size_t& nativeOffset) const;
+
+    /// Removes the entries of the basic blocks that start within |region|
+    void remove(Code::Region region);
+
+    size_t size() const { return m_entries.size(); }
+
+    size_t memoryFootprint() const { return m_entries.capacity() * sizeof(Entry); }
+
+    void serialise(Transfer::Serialiser& serialiser) const;
+    void deserialise(Transfer::Deserialiser& deserialiser);
+};
+}
\ No newline at end of file
@@ -2,9 +2,9 @@
 
 #include "Call.h"
 #include "ConditionalBranch.h"
+#include "HelperCall.h"
 #include "MinimalConditionalBranch.h"
 #include "SpecialLinkerOperation.h"
-#include "Support/Memory.h"
 #include "Transfer/Deserialiser.h"
 #include "Transfer/Serialiser.h"
 #include "UnconditionalBranch.h"
@@ -22,45 +22,90 @@ bool Linker::link(ARM::Functor& func, StaticAnalysis& analysis)
     return true;
 }
 
-void Linker::addOperation(ARM::Functor& func, std::unique_ptr<LinkOperation> operation)
+template <typename Operation, typename... Args>
+void Linker::addOperation(ARM::Functor& func, Args&&... args)
 {
+    Support::ArenaPtr<LinkOperation> operation(m_arena.create<Operation>(std::forward<Args>(args)...));
     operation->reserve(func);
     m_linkOperations.push_back(std::move(operation));
 }
 
 void Linker::addUnconditionalJump(ARM::Functor& func, size_t offset, int skipCount)
 {
-    addOperation(func, Support::make_unique<UnconditionalBranch>(func.length(), offset, skipCount));
+    addOperation<UnconditionalBranch>(func, func.length(), offset, skipCount);
+}
+
+bool Linker::nextOperationIsLong() const
+{
+    return !BranchRelaxation || m_longOperations.find(m_linkOperations.size()) != m_longOperations.end();
 }
 
 void Linker::addConditionalJump(ARM::Functor& func, size_t offset, int skipCount)
 {
-    addOperation(func, Support::make_unique<ConditionalBranch>(func.length(), offset, skipCount));
+    addOperation<ConditionalBranch>(func, func.length(), offset, skipCount, nextOperationIsLong());
 }
 
 void Linker::addMinimalBranchConditionalJump(ARM::Functor& func, size_t offset, int skipCount, ARM::Condition condition, ARM::Register cmp1, ARM::Register cmp2)
 {
-    addOperation(func, Support::make_unique<MinimalConditionalBranch>(func.length(), offset, skipCount, condition, cmp1, cmp2));
+    addOperation<MinimalConditionalBranch>(func, func.length(), offset, skipCount, condition, cmp1, cmp2, nextOperationIsLong());
+}
+
+void Linker::addMinimalBranchConditionalJump(ARM::Functor& func, size_t offset, int skipCount, ARM::Condition condition, ARM::Register cmp, uint8_t immediate)
+{
+    addOperation<MinimalConditionalBranch>(func, func.length(), offset, skipCount, condition, cmp, immediate, nextOperationIsLong());
 }
 
 void Linker::addCall(ARM::Functor& func, size_t offset)
 {
-    addOperation(func, Support::make_unique<Call>(func.length(), offset));
+    addOperation<Call>(func, func.length(), offset);
 }
 
 void Linker::addHalt(ARM::Functor& func)
 {
-    addOperation(func, Support::make_unique<SpecialLinkerOperation>(func.length(), SpecialLinkerOperation::Kind::Halt));
+    addOperation<SpecialLinkerOperation>(func, func.length(), SpecialLinkerOperation::Kind::Halt);
 }
 
 void Linker::addStackOverflowCheck(ARM::Functor& func)
 {
-    addOperation(func, Support::make_unique<SpecialLinkerOperation>(func.length(), SpecialLinkerOperation::Kind::StackOverflowError));
+    addOperation<SpecialLinkerOperation>(func, func.length(), SpecialLinkerOperation::Kind::StackOverflowError);
 }
 
 void Linker::addStackUnderflowCheck(ARM::Functor& func)
 {
-    addOperation(func, Support::make_unique<SpecialLinkerOperation>(func.length(), SpecialLinkerOperation::Kind::StackUnderflowError));
+    addOperation<SpecialLinkerOperation>(func, func.length(), SpecialLinkerOperation::Kind::StackUnderflowError);
+}
+
+void Linker::addStackCheckCall(ARM::Functor& func)
+{
+    addOperation<SpecialLinkerOperation>(func, func.length(), SpecialLinkerOperation::Kind::StackCheckCall);
+}
+
+void Linker::addStackOverflowCheckCall(ARM::Functor& func)
+{
+    addOperation<SpecialLinkerOperation>(func, func.length(), SpecialLinkerOperation::Kind::StackOverflowCheckCall);
+}
+
+void Linker::addStackUnderflowCheckCall(ARM::Functor& func)
+{
+    addOperation<SpecialLinkerOperation>(func, func.length(), SpecialLinkerOperation::Kind::StackUnderflowCheckCall);
+}
+
+void Linker::addComputedJump(ARM::Functor& func)
+{
+    addOperation<SpecialLinkerOperation>(func, func.length(), SpecialLinkerOperation::Kind::ComputedJump);
+}
+
+void Linker::addDivideCall(ARM::Functor& func)
+{
+    addOperation<SpecialLinkerOperation>(func, func.length(), SpecialLinkerOperation::Kind::DivideCall);
+}
+
+void Linker::addHelperCall(ARM::Functor& func, Environment::VMFunction helper)
+{
+    if (m_specialLocations.m_helperVeneers.find(helper) == m_specialLocations.m_helperVeneers.end()) {
+        m_helpersWithoutVeneers.insert(helper);
+    }
+    addOperation<HelperCall>(func, func.length(), helper);
 }
 
 void Linker::setHaltOffset(size_t offset)
@@ -78,50 +123,129 @@ void Linker::setStackOverflowOffset(size_t offset)
     m_specialLocations.m_locations[(int)SpecialLinkerOperation::Kind::StackOverflowError] = offset;
 }
 
-void Linker::setLinkOffset(size_t stackCodeOffset, size_t bytecodeOffset)
+void Linker::setStackCheckCallOffset(size_t offset)
 {
-    m_linkLocations[stackCodeOffset] = bytecodeOffset;
+    m_specialLocations.m_locations[(int)SpecialLinkerOperation::Kind::StackCheckCall] = offset;
+}
+
+void Linker::setStackOverflowCheckCallOffset(size_t offset)
+{
+    m_specialLocations.m_locations[(int)SpecialLinkerOperation::Kind::StackOverflowCheckCall] = offset;
+}
+
+void Linker::setStackUnderflowCheckCallOffset(size_t offset)
+{
+    m_specialLocations.m_locations[(int)SpecialLinkerOperation::Kind::StackUnderflowCheckCall] = offset;
+}
+
+void Linker::setComputedJumpOffset(size_t offset)
+{
+    m_specialLocations.m_locations[(int)SpecialLinkerOperation::Kind::ComputedJump] = offset;
+}
+
+void Linker::setIllegalJumpOffset(size_t offset)
+{
+    m_specialLocations.m_locations[(int)SpecialLinkerOperation::Kind::IllegalJumpError] = offset;
+}
+
+size_t Linker::illegalJumpOffset() const
+{
+    return m_specialLocations.m_locations[(int)SpecialLinkerOperation::Kind::IllegalJumpError];
+}
+
+void Linker::setDivideCallOffset(size_t offset)
+{
+    m_specialLocations.m_locations[(int)SpecialLinkerOperation::Kind::DivideCall] = offset;
+}
+
+void Linker::setHelperVeneerOffset(Environment::VMFunction helper, size_t offset)
+{
+    m_specialLocations.m_helperVeneers[helper] = offset;
+    m_helpersWithoutVeneers.erase(helper);
+}
+
+bool Linker::setLinkOffset(size_t stackCodeOffset, size_t bytecodeOffset)
+{
+    return m_linkLocations.set(stackCodeOffset, bytecodeOffset);
 }
 
 bool Linker::hasOffsetForBasicBlock(size_t offset) const
 {
-    return m_linkLocations.find(offset) != m_linkLocations.end();
+    return m_linkLocations.contains(offset);
 }
 
 size_t Linker::offsetForBasicBlock(size_t offset) const
 {
-    return m_linkLocations.find(offset)->second;
+    size_t nativeOffset = 0;
+    m_linkLocations.find(offset, nativeOffset);
+    return nativeOffset;
+}
+
+bool Linker::relaxBranches(const StaticAnalysis& analysis, size_t firstOperation)
+{
+    bool reachesAll = true;
+    for (size_t i = firstOperation; i < m_linkOperations.size(); ++i) {
+        if (!m_linkOperations[i]->reachesDestination(analysis, m_linkLocations, m_specialLocations)) {
+            m_longOperations.insert(i);
+            reachesAll = false;
+        }
+    }
+    return reachesAll;
 }
 
 void Linker::clear()
 {
-    m_linkOperations.clear();
+    // Swapping rather than clearing also drops the storage of the vector, which is in the arena
+    decltype(m_linkOperations)(m_linkOperations.get_allocator()).swap(m_linkOperations);
+    m_longOperations.clear();
+}
+
+void Linker::removeOperationsAfter(size_t operationCount)
+{
+    m_linkOperations.resize(operationCount);
+}
+
+void Linker::removeLinkOffsets(Code::Region region)
+{
+    m_linkLocations.remove(region);
+}
+
+size_t Linker::memoryFootprint() const
+{
+    // Each node of a std::map or std::set also has three pointers and a colour
+    const size_t nodeOverhead = 4 * sizeof(void*);
+    return m_linkLocations.memoryFootprint()
+        + m_specialLocations.m_helperVeneers.size() * (sizeof(std::pair<Environment::VMFunction, size_t>) + nodeOverhead)
+        + (m_helpersWithoutVeneers.size() + m_longOperations.size()) * (sizeof(size_t) + nodeOverhead);
 }
 
 void Linker::serialise()
 {
     Transfer::Serialiser serialiser("linker");
-    serialiser.appendUnsignedInt(m_linkLocations.size());
-    for (auto& pair : m_linkLocations) {
-        serialiser.appendUnsignedInt(pair.first);
+    m_linkLocations.serialise(serialiser);
+    for (size_t i = 0; i < SpecialLinkerLocations::Count; ++i) {
+        serialiser.appendUnsignedInt(m_specialLocations.m_locations[i]);
+    }
+    serialiser.appendUnsignedInt(m_specialLocations.m_helperVeneers.size());
+    for (auto& pair : m_specialLocations.m_helperVeneers) {
+        serialiser.appendUnsignedInt((uint32_t)pair.first);
         serialiser.appendUnsignedInt(pair.second);
     }
-    serialiser.appendUnsignedInt(m_specialLocations.m_locations[0]);
-    serialiser.appendUnsignedInt(m_specialLocations.m_locations[1]);
-    serialiser.appendUnsignedInt(m_specialLocations.m_locations[2]);
 }
 
 void Linker::deserialise()
 {
     Transfer::Deserialiser deserialiser("linker");
     if (deserialiser.exists() && deserialiser.length() > 0) {
-        size_t linkLocationCount = deserialiser.readUnsignedInt();
-        for (size_t i = 0; i < linkLocationCount; ++i) {
-            m_linkLocations[deserialiser.readUnsignedInt()] = deserialiser.readUnsignedInt();
+        m_linkLocations.deserialise(deserialiser);
+        for (size_t i = 0; i < SpecialLinkerLocations::Count; ++i) {
+            m_specialLocations.m_locations[i] = deserialiser.readUnsignedInt();
+        }
+        size_t helperVeneerCount = deserialiser.readUnsignedInt();
+        for (size_t i = 0; i < helperVeneerCount; ++i) {
+            auto helper = (Environment::VMFunction)deserialiser.readUnsignedInt();
+            m_specialLocations.m_helperVeneers[helper] = deserialiser.readUnsignedInt();
         }
-        m_specialLocations.m_locations[0] = deserialiser.readUnsignedInt();
-        m_specialLocations.m_locations[1] = deserialiser.readUnsignedInt();
-        m_specialLocations.m_locations[2] = deserialiser.readUnsignedInt();
     }
 }
 }
\ No newline at end of file
@@ -6,25 +6,37 @@
 #include "Code/Array.h"
 #include "Code/Region.h"
 #include "LinkOperation.h"
+#include "LinkTable.h"
 #include "SpecialLinkerLocations.h"
 #include "StaticAnalysis.h"
-#include <map>
-#include <memory>
+#include "Support/Arena.h"
+#include <set>
 #include <vector>
 
 namespace JIT {
 
 class Linker {
 private:
-    std::vector<std::unique_ptr<LinkOperation>> m_linkOperations;
-    std::map<size_t, size_t> m_linkLocations;
+    /// Allocated from the arena of the compiler, so they have to be cleared before the arena is reset
+    Support::Arena& m_arena;
+    Support::ArenaVector<Support::ArenaPtr<LinkOperation>> m_linkOperations;
+    LinkTable m_linkLocations;
     SpecialLinkerLocations m_specialLocations;
+    std::set<Environment::VMFunction> m_helpersWithoutVeneers;
 
-    void addOperation(ARM::Functor& func, std::unique_ptr<LinkOperation> operation);
+    /// Used for BranchRelaxation. The indices of the operations that have to be reserved in their long form.
+    std::set<size_t> m_longOperations;
+
+    /// Whether the next operation has to be reserved in its long form
+    bool nextOperationIsLong() const;
+
+    template <typename Operation, typename... Args>
+    void addOperation(ARM::Functor& func, Args&&... args);
 
 public:
-    Linker()
-        : m_linkOperations()
+    Linker(Support::Arena& arena)
+        : m_arena(arena)
+        , m_linkOperations(Support::ArenaAllocator<Support::ArenaPtr<LinkOperation>>(arena))
     {
     }
 
@@ -33,28 +45,76 @@ public:
     void addUnconditionalJump(ARM::Functor& func, size_t offset, int skipCount);
     void addConditionalJump(ARM::Functor& func, size_t offset, int skipCount);
     void addMinimalBranchConditionalJump(ARM::Functor& func, size_t offset, int skipCount, ARM::Condition condition, ARM::Register cmp1, ARM::Register cmp2);
+    void addMinimalBranchConditionalJump(ARM::Functor& func, size_t offset, int skipCount, ARM::Condition condition, ARM::Register cmp, uint8_t immediate);
     void addCall(ARM::Functor& func, size_t offset);
 
     void addHalt(ARM::Functor& func);
     void addStackOverflowCheck(ARM::Functor& func);
     void addStackUnderflowCheck(ARM::Functor& func);
 
+    /// Calls to the shared stack checks used for StackCheck::BoundsCheckByCall
+    void addStackCheckCall(ARM::Functor& func);
+    void addStackOverflowCheckCall(ARM::Functor& func);
+    void addStackUnderflowCheckCall(ARM::Functor& func);
+
+    /// Branch to the shared lookup for computed jumps, with the destination bytecode offset in TempRegister
+    void addComputedJump(ARM::Functor& func);
+
+    /// Call to the veneer for the division routine used for RegisterPreservingHelpers
+    void addDivideCall(ARM::Functor& func);
+
+    /// Call to the veneer shared by all calls to the C function |helper|
+    void addHelperCall(ARM::Functor& func, Environment::VMFunction helper);
+
     /// Set the offset to jump to when halting
     void setHaltOffset(size_t offset);
     /// Set the offset to jump to when stack underflow
     void setStackUnderflowOffset(size_t offset);
     /// Set the offset to jump to when stack overflow
     void setStackOverflowOffset(size_t offset);
+    /// Set the offset of the shared check for both pops and pushes
+    void setStackCheckCallOffset(size_t offset);
+    /// Set the offset of the shared check for pushes
+    void setStackOverflowCheckCallOffset(size_t offset);
+    /// Set the offset of the shared check for pops
+    void setStackUnderflowCheckCallOffset(size_t offset);
+    /// Set the offset of the shared lookup for computed jumps
+    void setComputedJumpOffset(size_t offset);
+    /// Set the offset of the code that computed jumps to unknown destinations use
+    void setIllegalJumpOffset(size_t offset);
+    size_t illegalJumpOffset() const;
+    /// Set the offset of the veneer for the division routine
+    void setDivideCallOffset(size_t offset);
+    /// The C functions that have been called with addHelperCall but don't have a veneer yet
+    const std::set<Environment::VMFunction>& helpersWithoutVeneers() const { return m_helpersWithoutVeneers; }
+    /// Set the offset of the veneer for |helper|
+    void setHelperVeneerOffset(Environment::VMFunction helper, size_t offset);
 
-    /// Should only be used for basic block heads
-    void setLinkOffset(size_t stackCodeOffset, size_t bytecodeOffset);
+    /// Should only be used for basic block heads. Returns false if the offsets are too large for the link table.
+    bool setLinkOffset(size_t stackCodeOffset, size_t bytecodeOffset);
 
     bool hasOffsetForBasicBlock(size_t offset) const;
     size_t offsetForBasicBlock(size_t offset) const;
 
-    /// After static analysis is complete you should clear the list of jobs
+    /**
+     * Used for BranchRelaxation. Checks that each operation from |firstOperation| onwards reaches its destination,
+     * which must have been compiled. Returns false if any don't, in which case they are reserved in their long form
+     * once the code from |firstOperation| onwards is discarded and compiled again.
+     */
+    bool relaxBranches(const StaticAnalysis& analysis, size_t firstOperation);
+
+    /// After static analysis is complete you should clear the list of jobs. This releases them from the arena.
     void clear();
 
+    size_t operationCount() const { return m_linkOperations.size(); }
+
+    /// An estimate of the heap memory used by the linker, other than the operations that are in the arena
+    size_t memoryFootprint() const;
+
+    /// Used when discarding compiled code that hasn't been linked yet
+    void removeOperationsAfter(size_t operationCount);
+    void removeLinkOffsets(Code::Region region);
+
     void serialise();
     void deserialise();
 };
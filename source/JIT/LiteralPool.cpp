@@ -0,0 +1,81 @@
+#include "Config.h"
+
+#include "LiteralPool.h"
+
+namespace JIT {
+
+/// In instructions from the load, which is less than the 1020 bytes allowed to keep clear of the PC alignment
+const size_t MaximumLoadDistance = 510;
+
+void LiteralPool::addLoad(ARM::Functor& func, int value, ARM::Register destination)
+{
+    size_t entry = 0;
+    while (entry < m_entries.size() && m_entries[entry] != value) {
+        ++entry;
+    }
+    if (entry == m_entries.size()) {
+        m_entries.push_back(value);
+    }
+
+    m_loads.push_back(Load{ func.length(), entry, destination });
+    func.add(ARM::nop());
+}
+
+bool LiteralPool::needsPlacement(const ARM::Functor& func, size_t upcomingInstructions) const
+{
+    if (isEmpty()) {
+        return false;
+    }
+
+    // The furthest the pool can start is after the upcoming instructions and a branch over it
+    auto start = dataOffset(func.length() + upcomingInstructions + 1);
+    for (auto& load : m_loads) {
+        if (start + 2 * load.m_entry - load.m_instructionOffset > MaximumLoadDistance) {
+            return true;
+        }
+    }
+
+    // Any new entries come after the existing ones
+    auto lastNewEntry = m_entries.size() + upcomingInstructions;
+    return start + 2 * lastNewEntry - func.length() > MaximumLoadDistance;
+}
+
+void LiteralPool::place(ARM::Functor& func)
+{
+    if (isEmpty()) {
+        return;
+    }
+
+    // Data needs to be aligned properly
+    if (func.length() % 2 == 1) {
+        func.add(ARM::nop());
+    }
+
+    auto start = func.length();
+    for (auto value : m_entries) {
+        func.addData(value);
+    }
+
+    // The PC is the address of the load plus four, rounded down to a multiple of four
+    for (auto& load : m_loads) {
+        auto pc = (load.m_instructionOffset + 2) & ~(size_t)1;
+        auto offset = (start + 2 * load.m_entry - pc) / 2;
+        *func.address(load.m_instructionOffset) = ARM::loadWordWithPCOffset(load.m_destination, (uint8_t)offset);
+    }
+
+    m_entries.clear();
+    m_loads.clear();
+}
+
+void LiteralPool::placeWithBranch(ARM::Functor& func)
+{
+    if (isEmpty()) {
+        return;
+    }
+
+    auto branch = func.length();
+    func.add(ARM::nop());
+    place(func);
+    *func.address(branch) = ARM::unconditionalBranch((int32_t)(func.length() - branch) - 2);
+}
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Config.h"
+
+#include "ARM/Functor.h"
+#include "Support/Arena.h"
+#include <cstddef>
+
+namespace JIT {
+
+/**
+ * Constants that are loaded with PC relative loads. Each load emits a placeholder that is filled in when the pool is
+ * placed, and loads of the same value share an entry. A load can only reach 1020 bytes forwards, so the pool has to be
+ * placed before its earliest load goes out of range, after which it starts again empty.
+ */
+class LiteralPool {
+private:
+    struct Load {
+        size_t m_instructionOffset;
+        size_t m_entry;
+        ARM::Register m_destination;
+    };
+
+    Support::ArenaVector<int> m_entries;
+    Support::ArenaVector<Load> m_loads;
+
+    /// The offset of the first entry of the pool if it were placed at |offset|
+    static size_t dataOffset(size_t offset) { return offset + offset % 2; }
+
+public:
+    LiteralPool(Support::Arena& arena)
+        : m_entries(Support::ArenaAllocator<int>(arena))
+        , m_loads(Support::ArenaAllocator<Load>(arena))
+    {
+    }
+
+    /// Emits a placeholder for a load of |value| to |destination|
+    void addLoad(ARM::Functor& func, int value, ARM::Register destination);
+
+    bool isEmpty() const { return m_loads.empty(); }
+
+    /**
+     * Returns true if the pool has to be placed now for its loads to stay in range, assuming that up to
+     * |upcomingInstructions| more instructions (which may all be loads of new values) are emitted first
+     */
+    bool needsPlacement(const ARM::Functor& func, size_t upcomingInstructions) const;
+
+    /// Places the pool at the end of |func|, which execution must never reach, e.g. after an unconditional branch
+    void place(ARM::Functor& func);
+
+    /// Places the pool at the end of |func| behind a branch over it
+    void placeWithBranch(ARM::Functor& func);
+};
+}
\ No newline at end of file
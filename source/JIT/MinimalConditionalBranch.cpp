@@ -6,29 +6,42 @@ namespace JIT {
 
 size_t MinimalConditionalBranch::instructionCount()
 {
-    return 3;
+    return m_isLong ? 3 : 2;
+}
+
+bool MinimalConditionalBranch::shortFormReaches(size_t realDestinationOffset)
+{
+    int offsetFromFirstInstruction = (int)realDestinationOffset - (insertionOffset() + 1) - 2;
+    return offsetFromFirstInstruction >= -128 && offsetFromFirstInstruction <= 127;
 }
 
 bool MinimalConditionalBranch::linkStackCode(ARM::Functor& func, size_t realDestinationOffset)
 {
     size_t i = insertionOffset();
-    uint16_t* buffer = func.buffer();
+    uint16_t* buffer = func.address(i);
 
-    buffer[i] = ARM::compareLowRegisters(m_operand1, m_operand2);
+    if (m_compareWithImmediate) {
+        buffer[0] = ARM::compareImmediate(m_operand1, m_immediate);
+    } else {
+        buffer[0] = ARM::compareLowRegisters(m_operand1, m_operand2);
+    }
 
     // -2 because awkward
-    int offsetFromFirstInstruction = (int)realDestinationOffset - (i + 1) - 2;
+    int offsetFromFirstInstruction = func.distance(i + 1, realDestinationOffset) - 2;
     if (offsetFromFirstInstruction < -128 || offsetFromFirstInstruction > 127) {
-        int offsetFromSecondInstruction = (int)realDestinationOffset - (i + 2) - 2;
+        if (!m_isLong) {
+            return false;
+        }
+        int offsetFromSecondInstruction = func.distance(i + 2, realDestinationOffset) - 2;
         if (offsetFromSecondInstruction < -1024 || offsetFromSecondInstruction > 1023) {
             // TODO Come up with a better strategy for handling this case
             return false;
         } else {
-            buffer[i + 1] = ARM::conditionalBranch(ARM::InvertCondition(m_condition), 0);
-            buffer[i + 2] = ARM::unconditionalBranch(offsetFromSecondInstruction);
+            buffer[1] = ARM::conditionalBranch(ARM::InvertCondition(m_condition), 0);
+            buffer[2] = ARM::unconditionalBranch(offsetFromSecondInstruction);
         }
     } else {
-        buffer[i + 1] = ARM::conditionalBranch(m_condition, offsetFromFirstInstruction);
+        buffer[1] = ARM::conditionalBranch(m_condition, offsetFromFirstInstruction);
     }
     return true;
 }
@@ -9,17 +9,40 @@ class MinimalConditionalBranch : public StackLinkOperation {
 private:
     ARM::Condition m_condition;
     ARM::Register m_operand1, m_operand2;
+    bool m_compareWithImmediate;
+    uint8_t m_immediate;
+    /// Whether there is space for a conditional branch over an unconditional branch, rather than just the former
+    bool m_isLong;
 
 public:
-    MinimalConditionalBranch(size_t startOffset, size_t to, int skipCount, ARM::Condition cond, ARM::Register cmp1, ARM::Register cmp2)
+    MinimalConditionalBranch(size_t startOffset, size_t to, int skipCount, ARM::Condition cond, ARM::Register cmp1, ARM::Register cmp2, bool isLong = true)
         : StackLinkOperation(startOffset, to, skipCount)
         , m_condition(cond)
         , m_operand1(cmp1)
         , m_operand2(cmp2)
+        , m_compareWithImmediate(false)
+        , m_immediate(0)
+        , m_isLong(isLong)
+    {
+    }
+
+    /**
+     * Compares |cmp| against |immediate| rather than against a second register
+     */
+    MinimalConditionalBranch(size_t startOffset, size_t to, int skipCount, ARM::Condition cond, ARM::Register cmp, uint8_t immediate, bool isLong = true)
+        : StackLinkOperation(startOffset, to, skipCount)
+        , m_condition(cond)
+        , m_operand1(cmp)
+        , m_operand2(cmp)
+        , m_compareWithImmediate(true)
+        , m_immediate(immediate)
+        , m_isLong(isLong)
     {
     }
 
     size_t instructionCount() final;
     bool linkStackCode(ARM::Functor& func, size_t realDestinationOffset) final;
+    bool isShort() final { return !m_isLong; }
+    bool shortFormReaches(size_t realDestinationOffset) final;
 };
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "ARM/Encoder.h"
 #include "ARM/Functor.h"
 #include "Config.h"
+#include "LiteralPool.h"
 #include <cstdint>
 #include <utility>
 
@@ -26,12 +27,67 @@ const static ARM::Register StackRegisters[] = {
 
 const static int32_t NumberOfRegistersAvailableForStack = NUMBER_OF_REGISTERS_FOR_STACK;
 
+/**
+ * The registers that may hold stack values across a basic block boundary when FunctionLevelRegisterAllocation is
+ * enabled. r5 is left out because the bounds check at the start of a basic block overwrites it with the check PC.
+ */
+const static ARM::Register BlockBoundaryRegisters[] = {
+    ARM::Register::r2,
+    ARM::Register::r4,
+    ARM::Register::r6,
+    ARM::Register::r7,
+};
+
+#define NUMBER_OF_BLOCK_BOUNDARY_REGISTERS (sizeof(BlockBoundaryRegisters) / sizeof(ARM::Register))
+
+/**
+ * Describes the register file at a basic block boundary: the stack pointer register points at the top of the stack,
+ * the top |m_count| stack values are held in |m_registers| (top first) and the remainder are in memory. The naive
+ * state is the layout with the single value in StackTopRegister.
+ */
+struct RegisterLayout {
+    int m_count;
+    ARM::Register m_registers[NUMBER_OF_BLOCK_BOUNDARY_REGISTERS];
+
+    static RegisterLayout naive() { return canonical(1); }
+
+    /**
+     * The layout used for |count| values at a block boundary; |count| is clamped to 1 <= count <= 4
+     */
+    static RegisterLayout canonical(int count)
+    {
+        RegisterLayout layout;
+        layout.m_count = count < 1 ? 1 : (count > (int)NUMBER_OF_BLOCK_BOUNDARY_REGISTERS ? (int)NUMBER_OF_BLOCK_BOUNDARY_REGISTERS : count);
+        for (int i = 0; i < (int)NUMBER_OF_BLOCK_BOUNDARY_REGISTERS; ++i) {
+            layout.m_registers[i] = BlockBoundaryRegisters[i];
+        }
+        return layout;
+    }
+
+    bool operator==(const RegisterLayout& other) const
+    {
+        if (m_count != other.m_count) {
+            return false;
+        }
+        for (int i = 0; i < m_count; ++i) {
+            if (m_registers[i] != other.m_registers[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const RegisterLayout& other) const { return !(*this == other); }
+};
+
 /**
  * An abstract class for handling which stack values are in which registers, how that corresponds
  * to the actual stack state, and reading/writing those values back to memory
  */
 class RegisterFileState {
 public:
+    virtual ~RegisterFileState() {}
+
     virtual bool inNaiveState() = 0;
 
     /**
@@ -111,6 +167,30 @@ public:
 
     virtual bool ntuck(ARM::Functor& func, int n) { return false; }
 
+    /**
+     * Only supported by the COW allocator, for FunctionLevelRegisterAllocation
+     *
+     * Emits the loads, stores and moves needed for the register file to match |layout|. The top |poppedCount| stack
+     * values are first popped and left in |poppedRegisters| (top first), which must not be part of |layout|. This is
+     * used to leave a branch condition or comparison operands in registers. Values of |layout| that aren't already in
+     * registers are loaded from memory, so it must not hold more values than are known to be on the stack. Returns
+     * whether this succeeded.
+     */
+    virtual bool returnToLayout(ARM::Functor& func, const RegisterLayout& layout, const ARM::Register* poppedRegisters, int poppedCount) { return false; }
+
+    /**
+     * Doesn't emit any assembly; used at the start of a basic block entered with |layout|
+     */
+    virtual void assumeLayout(const RegisterLayout& layout) {}
+
+    /**
+     * Doesn't emit any assembly; used when the stack pointer register has been left |offset| words below the top of
+     * stack by the bounds check at the start of a basic block
+     */
+    virtual void assumeStackPointerOffset(int offset) {}
+
+    virtual int numberOfRegistersHoldingValues() { return 1; }
+
     /**
      * Only used in a particular mode of the COW allocator
      * 
@@ -131,5 +211,11 @@ public:
 
     virtual void commitRegisterValue(ARM::Functor& func, int stackOffset) = 0;
     virtual void commitRegisterValue(ARM::Functor& func, ARM::Register reg) = 0;
+
+    /// Constants may be loaded from |pool| where that is shorter, unless it is null
+    void setLiteralPool(LiteralPool* pool) { m_literalPool = pool; }
+
+protected:
+    LiteralPool* m_literalPool = nullptr;
 };
 }
\ No newline at end of file
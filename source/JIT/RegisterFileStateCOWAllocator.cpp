@@ -14,6 +14,8 @@ RegisterFileStateCOWAllocator::RegisterFileStateCOWAllocator()
     , m_comparisonRegister2(ARM::Register::r0)
     , m_knowRegisterValue{ false }
     , m_registerValues{ 0 }
+    , m_registerHoldsConstant{ false }
+    , m_registerConstants{ 0 }
 {
     redetermineRegistersInUse();
 }
@@ -100,6 +102,8 @@ bool RegisterFileStateCOWAllocator::ensureRegistersHoldValues(int n, ARM::Functo
         auto offset = m_topOfStackOffsetFromStackPointer + m_numberOfRegistersHoldingValues;
         ++m_numberOfRegistersHoldingValues;
         func.add(ARM::loadWordWithOffset(nextRegister, StackPointerRegister, offset));
+        m_registerHoldsConstant[(int)nextRegister] = false;
+        didLoadRegister(nextRegister, offset);
     }
     return true;
 }
@@ -108,6 +112,8 @@ ARM::Register RegisterFileStateCOWAllocator::topOfStackWriteBackRegister()
 {
     m_readRegisterForOffset[0] = m_writeRegisterForOffset[0];
     redetermineRegistersInUse();
+    m_registerHoldsConstant[(int)m_writeRegisterForOffset[0]] = false;
+    didWriteRegister(m_writeRegisterForOffset[0]);
     return m_writeRegisterForOffset[0];
 }
 
@@ -149,6 +155,8 @@ ARM::Register RegisterFileStateCOWAllocator::push(ARM::Functor& func)
     m_knowRegisterValue[(int)reg] = false;
     m_readRegisterForOffset[0] = reg;
     m_writeRegisterForOffset[0] = reg;
+    m_registerHoldsConstant[(int)reg] = false;
+    didWriteRegister(reg);
 
     ++m_numberOfRegistersHoldingValues;
     --m_topOfStackOffsetFromStackPointer;
@@ -161,8 +169,9 @@ ARM::Register RegisterFileStateCOWAllocator::push(ARM::Functor& func)
 void RegisterFileStateCOWAllocator::commitRegisterValue(ARM::Functor& func, ARM::Register writeRegister)
 {
     if (registerValueIsKnown(writeRegister)) {
-        compileLoadConstant(func, knownRegisterValue(writeRegister), writeRegister);
+        materialiseConstant(func, knownRegisterValue(writeRegister), writeRegister);
         m_knowRegisterValue[(int)writeRegister] = false;
+        didWriteRegister(writeRegister);
     }
 }
 
@@ -191,13 +200,14 @@ bool RegisterFileStateCOWAllocator::returnToNaiveState(ARM::Functor& func, int o
     if (inNaiveState()) {
         return true;
     }
-    // Restore invariant for stack pointer register
-    if (m_topOfStackOffsetFromStackPointer > 0) {
-        func.add(ARM::addLargeImm(StackPointerRegister, m_topOfStackOffsetFromStackPointer * 4));
-    } else if (m_topOfStackOffsetFromStackPointer < 0) {
-        func.add(ARM::subLargeImm(StackPointerRegister, -m_topOfStackOffsetFromStackPointer * 4));
+    // Subclasses may leave the top of stack in memory
+    if (m_numberOfRegistersHoldingValues == 0 && !ensureRegistersHoldValues(1, func)) {
+        return false;
     }
 
+    // Restore invariant for stack pointer register
+    adjustStackPointer(func, m_topOfStackOffsetFromStackPointer);
+
     resetMemoryInvariant(func, offset, 0);
 
     if (offset == 1) {
@@ -217,6 +227,8 @@ bool RegisterFileStateCOWAllocator::returnToNaiveState(ARM::Functor& func, int o
     // We only restore this particular part of the invariant if we are doing a full reset
     if (offset == 1) {
         m_numberOfRegistersHoldingValues = 1;
+        forgetConstants();
+        didResetState();
     }
 
     redetermineRegistersInUse();
@@ -224,6 +236,16 @@ bool RegisterFileStateCOWAllocator::returnToNaiveState(ARM::Functor& func, int o
     return true;
 }
 
+void RegisterFileStateCOWAllocator::adjustStackPointer(ARM::Functor& func, int words)
+{
+    if (words > 0) {
+        func.add(ARM::addLargeImm(StackPointerRegister, words * 4));
+    } else if (words < 0) {
+        func.add(ARM::subLargeImm(StackPointerRegister, -words * 4));
+    }
+    didAdjustStackPointer(words);
+}
+
 void RegisterFileStateCOWAllocator::resetMemoryInvariant(ARM::Functor& func, int offset, int delta)
 {
     // This loop is split into two stages that 1) write values back to memory and 2) ensure that we
@@ -233,7 +255,10 @@ void RegisterFileStateCOWAllocator::resetMemoryInvariant(ARM::Functor& func, int
         //     write them to memory. In order to do this we may have to commit a value that is a
         //     compile time constant, hence the call to the |commitRegisterValue|
         commitRegisterValue(func, i);
-        func.add(ARM::storeWordWithOffset(readRegister(i), StackPointerRegister, i + delta));
+        if (!storeIsRedundant(readRegister(i), i + delta)) {
+            func.add(ARM::storeWordWithOffset(readRegister(i), StackPointerRegister, i + delta));
+            didStoreRegister(readRegister(i), i + delta);
+        }
 
         //  2. Values that are still on the stack might actually point to the same read register as
         //     the value we just wrote to the stack (with a different write register). Therefore to
@@ -352,11 +377,7 @@ bool RegisterFileStateCOWAllocator::returnToComparisonState(ARM::Functor& func)
     m_topOfStackOffsetFromStackPointer += 2;
 
     // Restore invariant for stack pointer register
-    if (m_topOfStackOffsetFromStackPointer > 0) {
-        func.add(ARM::addLargeImm(StackPointerRegister, m_topOfStackOffsetFromStackPointer * 4));
-    } else if (m_topOfStackOffsetFromStackPointer < 0) {
-        func.add(ARM::subLargeImm(StackPointerRegister, -m_topOfStackOffsetFromStackPointer * 4));
-    }
+    adjustStackPointer(func, m_topOfStackOffsetFromStackPointer);
 
     // For reset to invariant
     m_topOfStackOffsetFromStackPointer = 0;
@@ -425,6 +446,8 @@ bool RegisterFileStateCOWAllocator::returnToComparisonState(ARM::Functor& func)
     m_numberOfRegistersHoldingValues = 1;
     m_readRegisterForOffset[0] = m_writeRegisterForOffset[0] = StackTopRegister;
     redetermineRegistersInUse();
+    forgetConstants();
+    didResetState();
 
     return true;
 }
@@ -434,6 +457,120 @@ std::pair<ARM::Register, ARM::Register> RegisterFileStateCOWAllocator::compariso
     return std::pair<ARM::Register, ARM::Register>(m_comparisonRegister1, m_comparisonRegister2);
 }
 
+bool RegisterFileStateCOWAllocator::returnToLayout(ARM::Functor& func, const RegisterLayout& layout, const ARM::Register* poppedRegisters, int poppedCount)
+{
+    const int count = poppedCount + layout.m_count;
+
+    // Values that are popped must be in registers, as they would otherwise be loaded from above the stack pointer
+    if (!ensureRegistersHoldValues(poppedCount, func)) {
+        return false;
+    }
+
+    ARM::Register targets[REGISTER_COUNT];
+    for (int i = 0; i < count; ++i) {
+        targets[i] = i < poppedCount ? poppedRegisters[i] : layout.m_registers[i - poppedCount];
+    }
+
+    // Restore invariant for stack pointer register (including the popped values)
+    adjustStackPointer(func, m_topOfStackOffsetFromStackPointer + poppedCount);
+    m_topOfStackOffsetFromStackPointer = 0;
+
+    // Anything that doesn't fit in the layout goes back to memory first, whilst every register is still intact
+    resetMemoryInvariant(func, count, -poppedCount);
+
+    // Values held in registers are moved to their target registers. This is a parallel move, so a move can only be
+    // emitted once nothing else needs to read its destination; otherwise every remaining move is part of a cycle,
+    // which is broken with an exclusive-or swap so that no temporary register is needed
+    ARM::Register moveFrom[REGISTER_COUNT];
+    ARM::Register moveTo[REGISTER_COUNT];
+    int moveCount = 0;
+    for (int i = 0; i < count && i < m_numberOfRegistersHoldingValues; ++i) {
+        if (!registerValueIsKnown(m_writeRegisterForOffset[i]) && readRegister(i) != targets[i]) {
+            moveFrom[moveCount] = readRegister(i);
+            moveTo[moveCount] = targets[i];
+            ++moveCount;
+        }
+    }
+
+    while (moveCount > 0) {
+        int next = -1;
+        for (int i = 0; i < moveCount && next == -1; ++i) {
+            next = i;
+            for (int j = 0; j < moveCount; ++j) {
+                if (j != i && moveFrom[j] == moveTo[i]) {
+                    next = -1;
+                    break;
+                }
+            }
+        }
+
+        if (next != -1) {
+            func.add(ARM::moveLowToLow(moveTo[next], moveFrom[next]));
+        } else {
+            next = 0;
+            auto a = moveFrom[next];
+            auto b = moveTo[next];
+            func.add(ARM::eor(a, b));
+            func.add(ARM::eor(b, a));
+            func.add(ARM::eor(a, b));
+            for (int j = 0; j < moveCount; ++j) {
+                if (moveFrom[j] == a) {
+                    moveFrom[j] = b;
+                } else if (moveFrom[j] == b) {
+                    moveFrom[j] = a;
+                }
+            }
+        }
+
+        --moveCount;
+        moveFrom[next] = moveFrom[moveCount];
+        moveTo[next] = moveTo[moveCount];
+
+        // Swaps can turn other moves into no-ops
+        for (int i = moveCount - 1; i >= 0; --i) {
+            if (moveFrom[i] == moveTo[i]) {
+                --moveCount;
+                moveFrom[i] = moveFrom[moveCount];
+                moveTo[i] = moveTo[moveCount];
+            }
+        }
+    }
+
+    // Constants and values from memory never read a register, so they go last. The moves above overwrote registers
+    // without tracking their constants, but constants loaded here may still be derived from each other
+    forgetConstants();
+    for (int i = 0; i < count; ++i) {
+        if (i < m_numberOfRegistersHoldingValues) {
+            auto writeRegister = m_writeRegisterForOffset[i];
+            if (registerValueIsKnown(writeRegister)) {
+                materialiseConstant(func, knownRegisterValue(writeRegister), targets[i]);
+            }
+        } else {
+            func.add(ARM::loadWordWithOffset(targets[i], StackPointerRegister, i - poppedCount));
+        }
+    }
+
+    assumeLayout(layout);
+
+    return true;
+}
+
+void RegisterFileStateCOWAllocator::assumeLayout(const RegisterLayout& layout)
+{
+    for (int i = 0; i < REGISTER_COUNT; ++i) {
+        m_knowRegisterValue[i] = false;
+    }
+    for (int i = 0; i < layout.m_count; ++i) {
+        m_readRegisterForOffset[i] = layout.m_registers[i];
+        m_writeRegisterForOffset[i] = layout.m_registers[i];
+    }
+    m_numberOfRegistersHoldingValues = layout.m_count;
+    m_topOfStackOffsetFromStackPointer = 0;
+    redetermineRegistersInUse();
+    forgetConstants();
+    didResetState();
+}
+
 bool RegisterFileStateCOWAllocator::registerValueIsKnown(ARM::Register reg)
 {
     if (!RegisterWriteElimination) {
@@ -450,13 +587,70 @@ int RegisterFileStateCOWAllocator::knownRegisterValue(ARM::Register reg)
 void RegisterFileStateCOWAllocator::setKnownRegisterValue(ARM::Functor& func, ARM::Register reg, int value)
 {
     if (!RegisterWriteElimination) {
-        compileLoadConstant(func, value, reg);
+        materialiseConstant(func, value, reg);
+        didWriteRegister(reg);
         return;
     }
     m_knowRegisterValue[(int)reg] = true;
     m_registerValues[(int)reg] = value;
 }
 
+void RegisterFileStateCOWAllocator::materialiseConstant(ARM::Functor& func, int value, ARM::Register reg)
+{
+    // Each alternative must be strictly shorter than building the constant from scratch, and a literal is never
+    // loaded if it can be built in three instructions
+    int bestLength = constantSynthesisLength(value);
+    if (m_literalPool && bestLength > 3) {
+        bestLength = 3;
+    }
+    int bestSource = -1;
+    for (int i = 0; i < REGISTER_COUNT; ++i) {
+        if (!m_registerHoldsConstant[i]) {
+            continue;
+        }
+        auto difference = (int64_t)value - m_registerConstants[i];
+        int length;
+        if (i == (int)reg) {
+            length = difference == 0 ? 0 : 1;
+        } else {
+            length = difference == 0 || (difference >= -7 && difference <= 7) ? 1 : 2;
+        }
+        if (difference >= -0xFF && difference <= 0xFF && length < bestLength) {
+            bestLength = length;
+            bestSource = i;
+        }
+    }
+
+    if (bestSource == -1) {
+        compileLoadConstant(func, value, reg, m_literalPool);
+    } else {
+        auto source = (ARM::Register)bestSource;
+        auto difference = value - m_registerConstants[bestSource];
+        if (source != reg && difference >= -7 && difference <= 7 && difference != 0) {
+            func.add(difference > 0 ? ARM::addSmallImm(reg, source, difference) : ARM::subSmallImm(reg, source, -difference));
+        } else {
+            if (source != reg) {
+                func.add(ARM::moveLowToLow(reg, source));
+            }
+            if (difference > 0) {
+                func.add(ARM::addLargeImm(reg, difference));
+            } else if (difference < 0) {
+                func.add(ARM::subLargeImm(reg, -difference));
+            }
+        }
+    }
+
+    m_registerHoldsConstant[(int)reg] = true;
+    m_registerConstants[(int)reg] = value;
+}
+
+void RegisterFileStateCOWAllocator::forgetConstants()
+{
+    for (int i = 0; i < REGISTER_COUNT; ++i) {
+        m_registerHoldsConstant[i] = false;
+    }
+}
+
 void RegisterFileStateCOWAllocator::printStatus()
 {
     printf("COW allocator has %d stack values in registers:\n", m_numberOfRegistersHoldingValues);
@@ -27,12 +27,13 @@ namespace JIT {
  *    needed to access a stack value further down the stack that was statically known you
  *    wouldn't have to worry about *ever* writing it to Stack unless absolutely necessary
  *  - Support a 'smarter' naive state where the top five values are in registers, avoiding the
- *    need to access memory for a bunch of operations
+ *    need to access memory for a bunch of operations (FunctionLevelRegisterAllocation does this
+ *    for basic block boundaries within a function, but calls and returns still use the naive state)
  *  - Where NTUCK/NDUP/NROT operations can be statically determined, do
  *  - Deprecate the original RegisterFileState implementation
  */
 class RegisterFileStateCOWAllocator : public RegisterFileState {
-private:
+protected:
     bool m_registerIsInUse[REGISTER_COUNT];
 
     ARM::Register m_readRegisterForOffset[NUMBER_OF_REGISTERS_FOR_STACK];
@@ -48,6 +49,19 @@ private:
     bool m_knowRegisterValue[REGISTER_COUNT];
     int m_registerValues[REGISTER_COUNT];
 
+    /**
+     * Unlike the known values above, these are constants that have actually been loaded into registers. They stay
+     * valid after the register is freed, until it is next written to, so that nearby constants can be derived from
+     * them rather than being built from scratch.
+     */
+    bool m_registerHoldsConstant[REGISTER_COUNT];
+    int m_registerConstants[REGISTER_COUNT];
+
+    /// Loads |value| into |reg|, starting from a register that already holds a nearby constant if that is shorter
+    void materialiseConstant(ARM::Functor& func, int value, ARM::Register reg);
+
+    void forgetConstants();
+
     /**
      * Garbage collects the registers.
      *
@@ -72,11 +86,26 @@ private:
      */
     void resetMemoryInvariant(ARM::Functor& func, int offset, int delta);
 
+    /**
+     * Emits the add/sub to move the stack pointer register by |words| stack values
+     */
+    void adjustStackPointer(ARM::Functor& func, int words);
+
     /**
      * Prints a table showing which stack values are in which registers and which registers are in use
      */
     void printStatus();
 
+    // Hooks for subclasses that track the relationship between registers and memory. Offsets are in words relative to
+    // the current value of the stack pointer register
+    virtual void didLoadRegister(ARM::Register reg, int offset) {}
+    virtual void didWriteRegister(ARM::Register reg) {}
+    virtual bool storeIsRedundant(ARM::Register reg, int offset) { return false; }
+    virtual void didStoreRegister(ARM::Register reg, int offset) {}
+    virtual void didAdjustStackPointer(int words) {}
+    /// Called whenever arbitrary code may run afterwards, e.g. on return to the naive state
+    virtual void didResetState() {}
+
 public:
     RegisterFileStateCOWAllocator();
 
@@ -103,7 +132,7 @@ public:
     /// 0 <= n < 4
     // bool ndupTopOfStack(ARM::Functor& func);
 
-    bool dropTopOfStack(ARM::Functor& func) final;
+    bool dropTopOfStack(ARM::Functor& func) override;
 
     bool rot(ARM::Functor& func) final;
 
@@ -119,6 +148,14 @@ public:
 
     bool returnToComparisonState(ARM::Functor& func);
 
+    bool returnToLayout(ARM::Functor& func, const RegisterLayout& layout, const ARM::Register* poppedRegisters, int poppedCount) final;
+
+    void assumeLayout(const RegisterLayout& layout) final;
+
+    void assumeStackPointerOffset(int offset) final { m_topOfStackOffsetFromStackPointer += offset; }
+
+    int numberOfRegistersHoldingValues() final { return m_numberOfRegistersHoldingValues; }
+
     std::pair<ARM::Register, ARM::Register> comparisonRegisters();
 
     bool stackValueIsKnown(int index);
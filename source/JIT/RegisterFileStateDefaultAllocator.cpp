@@ -192,7 +192,7 @@ int RegisterFileStateDefaultAllocator::knownRegisterValue(ARM::Register reg)
 
 void RegisterFileStateDefaultAllocator::setKnownRegisterValue(ARM::Functor& func, ARM::Register reg, int value)
 {
-    compileLoadConstant(func, value, reg);
+    compileLoadConstant(func, value, reg, m_literalPool);
 }
 
 void RegisterFileStateDefaultAllocator::commitRegisterValue(ARM::Functor& func, int stackOffset)
@@ -0,0 +1,62 @@
+#include "RegisterFileStateSchedulingAllocator.h"
+
+namespace JIT {
+
+RegisterFileStateSchedulingAllocator::RegisterFileStateSchedulingAllocator()
+    : RegisterFileStateCOWAllocator()
+    , m_stackPointerAdjustment(0)
+{
+    didResetState();
+}
+
+void RegisterFileStateSchedulingAllocator::didLoadRegister(ARM::Register reg, int offset)
+{
+    m_slotForRegister[(int)reg] = m_stackPointerAdjustment + offset;
+}
+
+void RegisterFileStateSchedulingAllocator::didWriteRegister(ARM::Register reg)
+{
+    m_slotForRegister[(int)reg] = NoSlot;
+}
+
+bool RegisterFileStateSchedulingAllocator::storeIsRedundant(ARM::Register reg, int offset)
+{
+    return m_slotForRegister[(int)reg] == m_stackPointerAdjustment + offset;
+}
+
+void RegisterFileStateSchedulingAllocator::didStoreRegister(ARM::Register reg, int offset)
+{
+    auto slot = m_stackPointerAdjustment + offset;
+    // Other copies of the slot are now stale
+    for (int i = 0; i < REGISTER_COUNT; ++i) {
+        if (m_slotForRegister[i] == slot) {
+            m_slotForRegister[i] = NoSlot;
+        }
+    }
+    m_slotForRegister[(int)reg] = slot;
+}
+
+void RegisterFileStateSchedulingAllocator::didAdjustStackPointer(int words)
+{
+    m_stackPointerAdjustment += words;
+}
+
+void RegisterFileStateSchedulingAllocator::didResetState()
+{
+    for (int i = 0; i < REGISTER_COUNT; ++i) {
+        m_slotForRegister[i] = NoSlot;
+    }
+    m_stackPointerAdjustment = 0;
+}
+
+bool RegisterFileStateSchedulingAllocator::dropTopOfStack(ARM::Functor& func)
+{
+    if (m_numberOfRegistersHoldingValues == 0) {
+        // The value is still in memory, so there is nothing to do
+        ++m_topOfStackOffsetFromStackPointer;
+    } else {
+        pop();
+    }
+    return true;
+}
+}
\ No newline at end of file
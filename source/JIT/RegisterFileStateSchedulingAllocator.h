@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Config.h"
+#include "RegisterFileStateCOWAllocator.h"
+#include <climits>
+
+namespace JIT {
+
+/**
+ * Intra-block stack scheduling, loosely based on Koopman's stack scheduling paper. The copy-on-write maps already
+ * defer every register move for DUP, SWAP, ROT and TUCK; this allocator additionally schedules the memory traffic
+ * around them:
+ *
+ *  a) Each register that holds an unmodified copy of a stack slot remembers that slot, so writing the stack back to
+ *     memory skips values that are already there (e.g. values that were only read, or shuffled back into place)
+ *  b) DROP doesn't load the value underneath into a register; values are only loaded once something reads them
+ *
+ * Which stack slots are unmodified is only known between naive states, as any code emitted in the naive state (such as
+ * a call to the interpreter) may write to the stack.
+ */
+class RegisterFileStateSchedulingAllocator : public RegisterFileStateCOWAllocator {
+private:
+    const static int NoSlot = INT32_MIN;
+
+    /// The stack slot, relative to the stack pointer register at the last reset, that each register is a copy of
+    int m_slotForRegister[REGISTER_COUNT];
+
+    /// How far the stack pointer register has moved since the last reset, in words
+    int m_stackPointerAdjustment;
+
+protected:
+    void didLoadRegister(ARM::Register reg, int offset) final;
+    void didWriteRegister(ARM::Register reg) final;
+    bool storeIsRedundant(ARM::Register reg, int offset) final;
+    void didStoreRegister(ARM::Register reg, int offset) final;
+    void didAdjustStackPointer(int words) final;
+    void didResetState() final;
+
+public:
+    RegisterFileStateSchedulingAllocator();
+
+    bool dropTopOfStack(ARM::Functor& func) final;
+};
+}
\ No newline at end of file
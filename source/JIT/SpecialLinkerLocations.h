@@ -2,13 +2,20 @@
 
 #include "Config.h"
 
+#include "Environment/VM.h"
 #include <cstddef>
+#include <map>
 
 namespace JIT {
 
 /// OFFSETS of special linker locations for error handling and the like
 class SpecialLinkerLocations {
 public:
-    size_t m_locations[3];
+    static const size_t Count = 9;
+
+    size_t m_locations[Count];
+
+    /// The veneer for each C function called with HelperCall
+    std::map<Environment::VMFunction, size_t> m_helperVeneers;
 };
 }
\ No newline at end of file
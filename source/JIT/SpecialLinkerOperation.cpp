@@ -12,23 +12,27 @@ size_t SpecialLinkerOperation::instructionCount()
     return 2;
 }
 
-bool SpecialLinkerOperation::link(ARM::Functor& func, const StaticAnalysis& analysis, const std::map<size_t, size_t>& jumpOffsets, const SpecialLinkerLocations& specialLocations)
+bool SpecialLinkerOperation::link(ARM::Functor& func, const StaticAnalysis& analysis, const LinkTable& jumpOffsets, const SpecialLinkerLocations& specialLocations)
 {
     int i = insertionOffset();
-    int actualOffset = (destinationOffset(specialLocations) - i) - 2; // -2 from natural offset
+    int destination = destinationOffset(specialLocations);
+    int actualOffset = func.distance(i, destination) - 2; // -2 from natural offset
+    auto buffer = func.address(i);
     switch (m_kind) {
     case Kind::Halt:
-        func.buffer()[i] = ARM::unconditionalBranch(actualOffset);
+    case Kind::ComputedJump:
+    case Kind::IllegalJumpError:
+        buffer[0] = ARM::unconditionalBranch(actualOffset);
         break;
     case Kind::StackOverflowError: {
         if (actualOffset < -128 || actualOffset > 127) {
             if (actualOffset < -1024 || actualOffset > 1023) {
                 return false;
             }
-            func.buffer()[i] = ARM::conditionalBranch(ARM::Condition::ge, 0);
-            func.buffer()[i + 1] = ARM::unconditionalBranch(destinationOffset(specialLocations) - (i + 1) - 2);
+            buffer[0] = ARM::conditionalBranch(ARM::Condition::ge, 0);
+            buffer[1] = ARM::unconditionalBranch(func.distance(i + 1, destination) - 2);
         } else {
-            func.buffer()[i] = ARM::conditionalBranch(ARM::Condition::lt, actualOffset);
+            buffer[0] = ARM::conditionalBranch(ARM::Condition::lt, actualOffset);
         }
         break;
     }
@@ -37,13 +41,22 @@ bool SpecialLinkerOperation::link(ARM::Functor& func, const StaticAnalysis& anal
             if (actualOffset < -1024 || actualOffset > 1023) {
                 return false;
             }
-            func.buffer()[i] = ARM::conditionalBranch(ARM::Condition::le, 0);
-            func.buffer()[i + 1] = ARM::unconditionalBranch(destinationOffset(specialLocations) - (i + 1) - 2);
+            buffer[0] = ARM::conditionalBranch(ARM::Condition::le, 0);
+            buffer[1] = ARM::unconditionalBranch(func.distance(i + 1, destination) - 2);
         } else {
-            func.buffer()[i] = ARM::conditionalBranch(ARM::Condition::gt, actualOffset);
+            buffer[0] = ARM::conditionalBranch(ARM::Condition::gt, actualOffset);
         }
         break;
     }
+    case Kind::StackCheckCall:
+    case Kind::StackUnderflowCheckCall:
+    case Kind::StackOverflowCheckCall:
+    case Kind::DivideCall: {
+        auto pair = ARM::branchAndLinkNatural(func.distance(i, destination));
+        buffer[0] = pair.instruction1;
+        buffer[1] = pair.instruction2;
+        break;
+    }
     }
     return true;
 }
@@ -11,7 +11,16 @@ public:
     enum class Kind : int {
         Halt = 0,
         StackUnderflowError = 1,
-        StackOverflowError = 2
+        StackOverflowError = 2,
+        // Calls to the shared stack checks used for StackCheck::BoundsCheckByCall
+        StackCheckCall = 3,
+        StackUnderflowCheckCall = 4,
+        StackOverflowCheckCall = 5,
+        // The shared lookup for computed jumps, and the error code for destinations that aren't in the jump table
+        ComputedJump = 6,
+        IllegalJumpError = 7,
+        // Calls to the veneer for the division routine used for RegisterPreservingHelpers
+        DivideCall = 8
     };
 
 private:
@@ -27,6 +36,6 @@ public:
     }
 
     size_t instructionCount() final;
-    bool link(ARM::Functor& func, const StaticAnalysis& analysis, const std::map<size_t, size_t>& jumpOffsets, const SpecialLinkerLocations& specialLocations) final;
+    bool link(ARM::Functor& func, const StaticAnalysis& analysis, const LinkTable& jumpOffsets, const SpecialLinkerLocations& specialLocations) final;
 };
 }
\ No newline at end of file
@@ -2,14 +2,13 @@
 
 namespace JIT {
 
-bool StackLinkOperation::link(ARM::Functor& func, const StaticAnalysis& analysis, const std::map<size_t, size_t>& jumpOffsets, const SpecialLinkerLocations& specialLocations)
+bool StackLinkOperation::realDestinationOffset(const StaticAnalysis& analysis, const LinkTable& jumpOffsets, size_t& offset)
 {
     auto functionLocInBytecode = destination();
-    auto destinationIter = jumpOffsets.find(functionLocInBytecode);
-    if (destinationIter == jumpOffsets.end()) {
+    size_t destination;
+    if (!jumpOffsets.find(functionLocInBytecode, destination)) {
         return false;
     }
-    auto destination = destinationIter->second;
     if (!isCall()) {
         if (analysis.isCallDestination(functionLocInBytecode) && analysis.functionNeedsToPushRegisters(functionLocInBytecode)) {
             // Go one forward
@@ -17,9 +16,38 @@ bool StackLinkOperation::link(ARM::Functor& func, const StaticAnalysis& analysis
         }
         destination += m_skipCount;
     }
+    offset = destination;
+    return true;
+}
+
+bool StackLinkOperation::link(ARM::Functor& func, const StaticAnalysis& analysis, const LinkTable& jumpOffsets, const SpecialLinkerLocations& specialLocations)
+{
+    size_t destination;
+    if (!realDestinationOffset(analysis, jumpOffsets, destination)) {
+        return false;
+    }
     return linkStackCode(func, destination);
 }
 
+bool StackLinkOperation::isShort()
+{
+    return false;
+}
+
+bool StackLinkOperation::shortFormReaches(size_t realDestinationOffset)
+{
+    return true;
+}
+
+bool StackLinkOperation::reachesDestination(const StaticAnalysis& analysis, const LinkTable& jumpOffsets, const SpecialLinkerLocations& specialLocations)
+{
+    if (!isShort()) {
+        return true;
+    }
+    size_t destination;
+    return realDestinationOffset(analysis, jumpOffsets, destination) && shortFormReaches(destination);
+}
+
 bool StackLinkOperation::isCall()
 {
     return false;
@@ -24,9 +24,20 @@ public:
 
     virtual bool isCall();
 
+    /// Returns false if the destination hasn't been compiled yet
+    bool realDestinationOffset(const StaticAnalysis& analysis, const LinkTable& jumpOffsets, size_t& offset);
+
     /// Subclasses should override this
     virtual bool linkStackCode(ARM::Functor& func, size_t realDestinationOffset);
 
-    bool link(ARM::Functor& func, const StaticAnalysis& analysis, const std::map<size_t, size_t>& jumpOffsets, const SpecialLinkerLocations& specialLocations) final;
+    /// Used for BranchRelaxation. Whether the operation is reserved in a short form that might not reach its destination
+    virtual bool isShort();
+
+    /// Whether the short form reaches |realDestinationOffset|
+    virtual bool shortFormReaches(size_t realDestinationOffset);
+
+    bool reachesDestination(const StaticAnalysis& analysis, const LinkTable& jumpOffsets, const SpecialLinkerLocations& specialLocations) final;
+
+    bool link(ARM::Functor& func, const StaticAnalysis& analysis, const LinkTable& jumpOffsets, const SpecialLinkerLocations& specialLocations) final;
 };
 }
@@ -1,6 +1,9 @@
 #include "StaticAnalysis.h"
 
 #include "Bit/Bit.h"
+#include "CallGraph.h"
+#include "ComputedJumpTargets.h"
+#include "Code/InstructionStackEffect.h"
 #include "Code/Iterator.h"
 #include "InstructionSelection.h"
 #include "Queue.h"
@@ -12,6 +15,8 @@
 
 namespace JIT {
 
+const uint16_t BasicBlockSummary::NoBlock;
+
 StaticAnalysis::Status StaticAnalysis::analyse()
 {
     return analyse(0);
@@ -19,26 +24,112 @@ StaticAnalysis::Status StaticAnalysis::analyse()
 
 StaticAnalysis::Status StaticAnalysis::analyse(size_t offset)
 {
+    auto previousFunctionCount = m_functionRegions.size();
+
     auto callLocRes = determineCallLocations(offset);
+
+    // Not strictly necessary but ensures static analysis prints in order. The earlier regions are already sorted.
+    auto newFunctions = m_functionRegions.begin() + previousFunctionCount;
+    std::sort(newFunctions, m_functionRegions.end());
+    std::inplace_merge(m_functionRegions.begin(), newFunctions, m_functionRegions.end());
+
     if (callLocRes != Status::Success) {
         return callLocRes;
     }
 
-    auto verifiedLocations = verifyInstructionMetadata();
-    if (verifiedLocations != Status::Success) {
-        return verifiedLocations;
-    } else if (m_functionRegions.size() > 0) {
-        // Not strictly necessary but ensures static analysis prints in order
-        std::sort(m_functionRegions.begin(), m_functionRegions.end());
+    // Only the metadata of the new functions has changed
+    for (auto& region : m_newFunctionRegions) {
+        auto verifiedLocations = verifyInstructionMetadata(region);
+        if (verifiedLocations != Status::Success) {
+            return verifiedLocations;
+        }
+    }
 
-        m_codeRegion = m_functionRegions[0];
-        for (auto& region : m_functionRegions) {
+    if (m_newFunctionRegions.size() > 0) {
+        if (previousFunctionCount == 0) {
+            m_codeRegion = m_newFunctionRegions[0];
+        }
+        for (auto& region : m_newFunctionRegions) {
             m_codeRegion = m_codeRegion.add(region);
         }
     }
+
+    return buildBlockTable(m_newFunctionRegions);
+}
+
+StaticAnalysis::Status StaticAnalysis::buildBlockTable(const std::vector<Code::Region>& functions)
+{
+    // Every offset is at most the length of the code, i.e. the end of the last block
+    if (m_source.length() > UINT16_MAX) {
+        printf("Code is too long for the block table\n");
+        return Status::BlockTableOverflow;
+    }
+
+    auto firstNewBlock = m_blocks.size();
+    std::vector<Code::Region> blocks;
+    for (auto function : functions) {
+        blocks.clear();
+        appendBasicBlocks(function, blocks);
+        // Indices must be less than NoBlock
+        if (m_blocks.size() + blocks.size() >= BasicBlockSummary::NoBlock) {
+            printf("Too many basic blocks for the block table\n");
+            return Status::BlockTableOverflow;
+        }
+        m_functionBlocks[function.start()] = FunctionBlocks{ (uint16_t)m_blocks.size(), (uint16_t)blocks.size() };
+        for (auto block : blocks) {
+            if (m_blockIndices[block.start()] == BasicBlockSummary::NoBlock) {
+                m_blockIndices[block.start()] = (uint16_t)m_blocks.size();
+            }
+            m_blocks.emplace_back(block, Code::BlockStackEffect(Code::Iterator(m_source, block)), function.start());
+        }
+    }
+
+    // Successors may be in any of the new functions, so are only found once all of their blocks are in the table
+    for (auto i = firstNewBlock; i < m_blocks.size(); ++i) {
+        auto& summary = m_blocks[i];
+        auto region = summary.region();
+        summary.m_fallThroughSuccessor = blockIndex(region.end());
+        for (Code::Iterator iter(m_source, region); !iter.finished(); ++iter) {
+            auto instr = iter.instruction();
+            if (isJump(instr)) {
+                if (iter.lastWasPush()) {
+                    summary.m_jumpSuccessor = blockIndex((size_t)iter.pushValue());
+                }
+                if (instr == Code::Instruction::Jmp) {
+                    summary.m_fallThroughSuccessor = BasicBlockSummary::NoBlock;
+                } else {
+                    summary.m_fallThroughSuccessor = blockIndex(iter.nextIndex());
+                }
+                break;
+            } else if (instr == Code::Instruction::Ret || instr == Code::Instruction::Halt) {
+                summary.m_fallThroughSuccessor = BasicBlockSummary::NoBlock;
+                break;
+            }
+        }
+    }
     return Status::Success;
 }
 
+const BasicBlockSummary* StaticAnalysis::blockSummary(Code::Region basicBlock) const
+{
+    auto index = blockIndex(basicBlock.start());
+    // Overlapping functions may end a shared block at different offsets, in which case only the first is indexed
+    if (index == BasicBlockSummary::NoBlock || m_blocks[index].m_length != basicBlock.length()) {
+        return nullptr;
+    }
+    return &m_blocks[index];
+}
+
+const BasicBlockSummary* StaticAnalysis::blocksForFunction(size_t functionStart, size_t& count) const
+{
+    auto blocks = m_functionBlocks.find(functionStart);
+    if (blocks == m_functionBlocks.end()) {
+        return nullptr;
+    }
+    count = blocks->second.m_count;
+    return m_blocks.data() + blocks->second.m_first;
+}
+
 StaticAnalysis::Status StaticAnalysis::determineCallLocations(size_t offset)
 {
     // m_FunctionRegions is global, but this is just for newly discovered functions
@@ -53,6 +144,11 @@ StaticAnalysis::Status StaticAnalysis::determineCallLocations(size_t offset)
     Queue basicBlockLocations;
     functionLocations.push(offset);
 
+    // Nodes are numbered in the same order as m_newFunctionRegions
+    CallGraph callGraph;
+    // The node of the caller and the offset of the callee, which may not have been found yet
+    std::vector<std::pair<size_t, size_t>> tailCalls;
+
     while (!functionLocations.empty()) {
         auto fHead = functionLocations.pop();
         // We have already visited this function
@@ -62,14 +158,37 @@ StaticAnalysis::Status StaticAnalysis::determineCallLocations(size_t offset)
 
         m_metadata[fHead] = m_metadata[fHead] | InstructionMetadata::FunctionStart;
 
-        bool functionHasRecursiveCalls = false;
+        auto node = callGraph.addFunction();
+
+        // The destinations of computed jumps are found once the rest of the function has been, and may lead to more
+        bool functionHasComputedJumps = false;
+        bool findComputedJumpTargets = false;
 
         basicBlockLocations.reset();
 
         basicBlockLocations.push(fHead);
         size_t fEnd = fHead;
 
-        while (!basicBlockLocations.empty()) {
+        while (!basicBlockLocations.empty() || findComputedJumpTargets) {
+            if (basicBlockLocations.empty()) {
+                findComputedJumpTargets = false;
+                std::vector<size_t> targets;
+                bool proven = ComputedJumpTargets(m_source, m_metadata).find(fHead, targets);
+                for (auto target : targets) {
+                    // The destination has to be a block of this function that isn't in the middle of an instruction
+                    if (target < fHead || any(m_metadata[target] & InstructionMetadata::Illegal)) {
+                        proven = false;
+                        continue;
+                    }
+                    m_metadata[target] = m_metadata[target] | InstructionMetadata::ComputedJumpTarget;
+                    basicBlockLocations.push(target);
+                }
+                if (!proven && m_unprovenComputedJumpFunctions.insert(fHead).second) {
+                    printf("WARNING: Computed jumps in function at %d may reach code that wasn't found\n", (int)fHead);
+                }
+                continue;
+            }
+
             auto blockHead = basicBlockLocations.pop();
             if (any(m_metadata[blockHead] & InstructionMetadata::BasicBlockStart)) {
                 // Already visited this basic block
@@ -77,12 +196,17 @@ StaticAnalysis::Status StaticAnalysis::determineCallLocations(size_t offset)
             }
 
             m_metadata[blockHead] = m_metadata[blockHead] | InstructionMetadata::BasicBlockStart;
+            // A new block may have new paths to a computed jump
+            findComputedJumpTargets = functionHasComputedJumps;
 
             Code::Region blockRegion(blockHead, end - blockHead);
 
             Code::Iterator iter(m_source, blockRegion);
             for (; !iter.finished(); ++iter) {
                 m_metadata[iter.index()] = m_metadata[iter.index()] | InstructionMetadata::Code;
+                for (auto i = iter.index() + 1; i < iter.nextIndex() && i < end; ++i) {
+                    m_metadata[i] = m_metadata[i] | InstructionMetadata::Illegal;
+                }
 
                 if (iter.index() - iter.lastIndex() == 3) {
                     m_metadata[iter.index()] = m_metadata[iter.index()] | InstructionMetadata::LastInstructionTripleWidth;
@@ -94,13 +218,15 @@ StaticAnalysis::Status StaticAnalysis::determineCallLocations(size_t offset)
                     m_hasHalts = true;
                 }
 
-                if (iter.instruction() == Code::Instruction::Call && iter.lastWasPush() && iter.pushValue() == fHead) {
-                    if (iter.hasMoreInstructions()) {
-                        // If a call is followed by a return instruction then this is tail call, and not a recursive call
-                        functionHasRecursiveCalls |= iter.nextInstruction() != Code::Instruction::Ret;
+                if (iter.instruction() == Code::Instruction::Call && iter.lastWasPush()) {
+                    // If a call is followed by a return instruction then this is tail call, which may be a branch
+                    if (!iter.hasMoreInstructions() || iter.nextInstruction() != Code::Instruction::Ret) {
+                        callGraph.setClobbersLinkRegister(node);
+                    } else if ((size_t)iter.pushValue() != fHead) {
+                        tailCalls.emplace_back(node, (size_t)iter.pushValue());
                     }
-                } else if (instructionImplementedWithCall(iter.instruction())) {
-                    functionHasRecursiveCalls = true;
+                } else if (instructionClobbersLinkRegister(iter.instruction())) {
+                    callGraph.setClobbersLinkRegister(node);
                 }
 
                 // Next instruction is unreachable from this one
@@ -108,12 +234,18 @@ StaticAnalysis::Status StaticAnalysis::determineCallLocations(size_t offset)
                     fEnd = std::max(fEnd, iter.index() + 1);
                     break;
                 } else if (isJump(iter.instruction())) {
-                    if (!iter.lastWasPush()) {
+                    if (iter.lastWasPush()) {
+                        if (iter.pushValue() < fHead || (size_t)iter.pushValue() >= end) {
+                            return Status::IllegalJump;
+                        }
+                        basicBlockLocations.push(iter.pushValue());
+                    } else if (ComputedJumps) {
+                        m_hasComputedJumps = true;
+                        functionHasComputedJumps = true;
+                        findComputedJumpTargets = true;
+                    } else {
                         return Status::VariableJumpNotAllowed;
                     }
-                    if (iter.pushValue() < fHead || (size_t)iter.pushValue() >= end) {
-                        return Status::IllegalJump;
-                    }
 
                     // A new basic block starts immediately after a conditional jump
                     // because execution can fall through
@@ -121,8 +253,6 @@ StaticAnalysis::Status StaticAnalysis::determineCallLocations(size_t offset)
                         basicBlockLocations.push(iter.nextIndex());
                     }
 
-                    basicBlockLocations.push(iter.pushValue());
-
                     // If the jump is at the end of a function then we need to know the 'next index' to correctly
                     // find the end of the function
                     ++iter;
@@ -150,8 +280,26 @@ StaticAnalysis::Status StaticAnalysis::determineCallLocations(size_t offset)
         auto functionRegion = Code::Region(fHead, fEnd - fHead);
         m_functionRegions.push_back(functionRegion);
         m_newFunctionRegions.push_back(functionRegion);
+    }
 
-        if (!functionHasRecursiveCalls && TailCallsOptimised) {
+    std::map<size_t, size_t> newFunctionNodes;
+    for (size_t node = 0; node < m_newFunctionRegions.size(); ++node) {
+        newFunctionNodes[m_newFunctionRegions[node].start()] = node;
+    }
+    for (auto& call : tailCalls) {
+        auto callee = newFunctionNodes.find(call.second);
+        if (callee != newFunctionNodes.end()) {
+            callGraph.addTailCall(call.first, callee->second);
+        } else {
+            // Functions from an earlier analysis have already been compiled, possibly out of range of a branch
+            callGraph.setClobbersLinkRegister(call.first);
+        }
+    }
+    callGraph.resolve();
+
+    for (size_t node = 0; node < m_newFunctionRegions.size(); ++node) {
+        if (!callGraph.savesLinkRegister(node) && TailCallsOptimised) {
+            auto fHead = m_newFunctionRegions[node].start();
             m_metadata[fHead] = m_metadata[fHead] | InstructionMetadata::NoRecursion;
         }
     }
@@ -159,10 +307,10 @@ StaticAnalysis::Status StaticAnalysis::determineCallLocations(size_t offset)
     return Status::Success;
 }
 
-StaticAnalysis::Status StaticAnalysis::verifyInstructionMetadata() const
+StaticAnalysis::Status StaticAnalysis::verifyInstructionMetadata(Code::Region region) const
 {
-    for (auto metadata : m_metadata) {
-        auto violated = violatedProperty(metadata);
+    for (auto i = region.start(); i < region.end() && i < m_metadata.size(); ++i) {
+        auto violated = violatedProperty(m_metadata[i]);
         switch (violated) {
         case InstructionMetadata::Code:
             return Status::CodeOverlapsWithIllegalInstruction;
@@ -182,9 +330,25 @@ StaticAnalysis::Status StaticAnalysis::verifyInstructionMetadata() const
 
 bool StaticAnalysis::functionNeedsToPushRegisters(size_t i) const
 {
+    // Calls to the shared stack checks overwrite the link register
+    if (m_stackCheckMode == StackCheck::BoundsCheckByCall) {
+        return true;
+    }
     return !any(m_metadata[i] & InstructionMetadata::NoRecursion);
 }
 
+size_t StaticAnalysis::memoryFootprint() const
+{
+    // Each node of a std::map also has three pointers and a colour
+    const size_t mapNodeOverhead = 4 * sizeof(void*);
+    return m_metadata.capacity() * sizeof(InstructionMetadata)
+        + (m_functionRegions.capacity() + m_newFunctionRegions.capacity()) * sizeof(Code::Region)
+        + m_functionStackEffects.size() * (sizeof(std::pair<size_t, FunctionStackEffect>) + mapNodeOverhead)
+        + m_blocks.capacity() * sizeof(BasicBlockSummary) + m_blockIndices.capacity() * sizeof(uint16_t)
+        + m_functionBlocks.size() * (sizeof(std::pair<size_t, FunctionBlocks>) + mapNodeOverhead)
+        + m_unprovenComputedJumpFunctions.size() * (sizeof(size_t) + mapNodeOverhead);
+}
+
 int StaticAnalysis::previousInstructionIndex(int offset) const
 {
     if (any(m_metadata[offset] & InstructionMetadata::LastInstructionTripleWidth)) {
@@ -236,8 +400,12 @@ void StaticAnalysis::printStaticAnalyis() const
                     printf("norec ");
                     width += 6; // strlen("norec ")
                 }
-                // 31 is the width of all these strings taken together
-                while (width < 31) {
+                if (any(meta & InstructionMetadata::ComputedJumpTarget)) {
+                    printf("target ");
+                    width += 7; // strlen("target ")
+                }
+                // 38 is the width of all these strings taken together
+                while (width < 38) {
                     printf(" ");
                     width++;
                 }
@@ -252,6 +420,39 @@ void StaticAnalysis::printStaticAnalyis() const
 std::vector<Code::Region> StaticAnalysis::basicBlocksForFunction(Code::Region functionRegion) const
 {
     std::vector<Code::Region> blocks;
+    appendBasicBlocks(functionRegion, blocks);
+    return blocks;
+}
+
+Support::ArenaVector<Code::Region> StaticAnalysis::basicBlocksForFunction(Code::Region functionRegion, Support::Arena& arena) const
+{
+    Support::ArenaVector<Code::Region> blocks{ Support::ArenaAllocator<Code::Region>(arena) };
+    // Growing the vector would waste its previous storage
+    size_t count = 0;
+    if (!blocksForFunction(functionRegion.start(), count)) {
+        for (Code::Iterator iter(m_source, functionRegion); !iter.finished(); ++iter) {
+            if (iter.index() == functionRegion.start() || isJumpDestination(iter.index())) {
+                ++count;
+            }
+        }
+    }
+    blocks.reserve(count);
+    appendBasicBlocks(functionRegion, blocks);
+    return blocks;
+}
+
+template <typename Blocks>
+void StaticAnalysis::appendBasicBlocks(Code::Region functionRegion, Blocks& blocks) const
+{
+    size_t count = 0;
+    auto summaries = blocksForFunction(functionRegion.start(), count);
+    if (summaries) {
+        for (size_t i = 0; i < count; ++i) {
+            blocks.emplace_back(summaries[i].region());
+        }
+        return;
+    }
+
     Code::Iterator iter(m_source, functionRegion);
     while (!iter.finished()) {
         auto start = iter.index();
@@ -262,11 +463,15 @@ std::vector<Code::Region> StaticAnalysis::basicBlocksForFunction(Code::Region fu
         auto end = iter.index();
         blocks.emplace_back(start, end - start);
     }
-    return blocks;
 }
 
 Code::Region StaticAnalysis::basicBlockAtIndex(int start) const
 {
+    auto index = blockIndex((size_t)start);
+    if (index != BasicBlockSummary::NoBlock) {
+        return m_blocks[index].region();
+    }
+
     auto iter = Code::Iterator(m_source, Code::Region(start, m_source.region().end() - start));
     // A basic block is at least one instruction, hence the initial ++iter;
     for (++iter; !iter.finished() && !isJumpDestination(iter.index()); ++iter) {
@@ -276,9 +481,154 @@ Code::Region StaticAnalysis::basicBlockAtIndex(int start) const
 
 Code::BlockStackEffect StaticAnalysis::stackEffectForBasicBlock(Code::Region basicBlock) const
 {
+    auto summary = blockSummary(basicBlock);
+    if (summary) {
+        return summary->m_effect;
+    }
     return Code::BlockStackEffect(Code::Iterator(m_source, basicBlock));
 }
 
+FunctionStackEffect StaticAnalysis::stackEffectForFunction(size_t functionStart)
+{
+    auto existing = m_functionStackEffects.find(functionStart);
+    if (existing != m_functionStackEffects.end()) {
+        return existing->second;
+    }
+    // Recursive calls find this unbounded effect whilst the function is being analysed
+    m_functionStackEffects[functionStart] = FunctionStackEffect();
+    auto effect = determineFunctionStackEffect(functionStart);
+    m_functionStackEffects[functionStart] = effect;
+    return effect;
+}
+
+FunctionStackEffect StaticAnalysis::determineFunctionStackEffect(size_t functionStart)
+{
+    Code::Region function;
+    bool found = false;
+    for (auto& region : m_functionRegions) {
+        if (region.start() == functionStart) {
+            function = region;
+            found = true;
+        }
+    }
+    if (!found) {
+        return FunctionStackEffect();
+    }
+    for (auto& region : m_functionRegions) {
+        // If functions overlap then other functions might jump into its basic blocks
+        if (!(region == function) && region.start() < function.end() && function.start() < region.end()) {
+            return FunctionStackEffect();
+        }
+    }
+
+    // Heights are the number of values above the entry height. Each basic block must always be entered at the same
+    // height, otherwise a loop could grow or shrink the stack without bound
+    std::map<size_t, int> blockHeights;
+    std::vector<size_t> blocksToVisit;
+    auto enterBlock = [&](size_t block, int height) {
+        if (!function.contains(block)) {
+            return false;
+        }
+        auto existing = blockHeights.find(block);
+        if (existing != blockHeights.end()) {
+            return existing->second == height;
+        }
+        blockHeights[block] = height;
+        blocksToVisit.push_back(block);
+        return true;
+    };
+    enterBlock(functionStart, 0);
+
+    int minimumHeight = 0, maximumHeight = 0;
+    bool returns = false;
+    int returnHeight = 0;
+
+    while (!blocksToVisit.empty()) {
+        auto blockStart = blocksToVisit.back();
+        blocksToVisit.pop_back();
+        int height = blockHeights[blockStart];
+        bool terminated = false;
+
+        Code::Iterator iter(m_source, Code::Region(blockStart, function.end() - blockStart));
+        for (; !iter.finished(); ++iter) {
+            if (iter.index() != blockStart && isJumpDestination(iter.index())) {
+                // Falls through to the next basic block
+                if (!enterBlock(iter.index(), height)) {
+                    return FunctionStackEffect();
+                }
+                terminated = true;
+                break;
+            }
+
+            auto instr = iter.instruction();
+            if (instr == Code::Instruction::Ndup || instr == Code::Instruction::Ntuck || instr == Code::Instruction::Nrot) {
+                if (!iter.lastWasPush()) {
+                    return FunctionStackEffect();
+                }
+                minimumHeight = std::min(minimumHeight, height - iter.pushValue());
+                if (instr != Code::Instruction::Ndup) {
+                    height--;
+                }
+                continue;
+            }
+
+            Code::InstructionStackEffect effect(instr);
+            int popCount = effect.popCount();
+            int pushCount = effect.pushCount();
+            if (iter.currentIsOptional()) {
+                popCount = iter.optionalPopCount();
+                pushCount = iter.optionalPushCount();
+            } else if (!effect.deterministicPops()) {
+                return FunctionStackEffect();
+            }
+            height -= popCount;
+            minimumHeight = std::min(minimumHeight, height);
+            height += pushCount;
+            maximumHeight = std::max(maximumHeight, height);
+
+            if (instr == Code::Instruction::Call) {
+                if (!iter.lastWasPush()) {
+                    return FunctionStackEffect();
+                }
+                auto callee = stackEffectForFunction(iter.pushValue());
+                if (!callee.bounded()) {
+                    return FunctionStackEffect();
+                }
+                minimumHeight = std::min(minimumHeight, height - callee.popCount());
+                maximumHeight = std::max(maximumHeight, height + callee.pushCount());
+                height -= callee.heightDifference();
+            } else if (isJump(instr)) {
+                if (!iter.lastWasPush() || !enterBlock(iter.pushValue(), height)) {
+                    return FunctionStackEffect();
+                }
+                if (instr == Code::Instruction::Cjmp && !enterBlock(iter.nextIndex(), height)) {
+                    return FunctionStackEffect();
+                }
+                terminated = true;
+                break;
+            } else if (instr == Code::Instruction::Ret) {
+                if (returns && returnHeight != height) {
+                    return FunctionStackEffect();
+                }
+                returns = true;
+                returnHeight = height;
+                terminated = true;
+                break;
+            } else if (instr == Code::Instruction::Halt) {
+                terminated = true;
+                break;
+            }
+        }
+
+        if (!terminated) {
+            // Falls off the end of the function
+            return FunctionStackEffect();
+        }
+    }
+
+    return FunctionStackEffect(-minimumHeight, maximumHeight, -returnHeight);
+}
+
 static const char* statusStrings[] = {
     "UnknownFailure",
     "Success",
@@ -288,7 +638,8 @@ static const char* statusStrings[] = {
     "FunctionStartNotTreatedAsBasicBlock",
     "VariableJumpNotAllowed",
     "IllegalJump",
-    "IllegalCall"
+    "IllegalCall",
+    "BlockTableOverflow"
 };
 
 const char* StaticAnalysis::statusString(Status status)
@@ -305,6 +656,7 @@ void StaticAnalysis::serialise()
     serialiser.appendUnsignedInt(m_dataRegion.length());
     serialiser.appendInt(m_hasHalts);
     serialiser.appendInt(m_hasDynamicCalls);
+    serialiser.appendInt(m_hasComputedJumps);
 
     serialiser.appendUnsignedInt(m_metadata.size());
     serialiser.appendData((uint8_t*)m_metadata.data(), m_metadata.size() * sizeof(InstructionMetadata));
@@ -334,6 +686,7 @@ void StaticAnalysis::deserialise()
 
         m_hasHalts = deserialiser.readInt();
         m_hasDynamicCalls = deserialiser.readInt();
+        m_hasComputedJumps = deserialiser.readInt();
 
         size_t metadataLength = deserialiser.readUnsignedInt();
         m_metadata = std::vector<InstructionMetadata>(metadataLength, InstructionMetadata::Nothing);
@@ -346,6 +699,12 @@ void StaticAnalysis::deserialise()
         size_t newFunctionRegionLength = deserialiser.readUnsignedInt();
         m_newFunctionRegions = std::vector<Code::Region>(newFunctionRegionLength, Code::Region());
         deserialiser.readData((uint8_t*)m_newFunctionRegions.data(), newFunctionRegionLength / sizeof(Code::Region));
+
+        // The block table is cheaper to rebuild than to store, and fits as it did when the code was analysed
+        m_blocks.clear();
+        m_blockIndices.assign(metadataLength, BasicBlockSummary::NoBlock);
+        m_functionBlocks.clear();
+        buildBlockTable(m_functionRegions);
     }
 }
 }
\ No newline at end of file
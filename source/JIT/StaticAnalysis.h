@@ -6,12 +6,90 @@
 #include "Code/BlockStackEffect.h"
 #include "Code/Region.h"
 #include "InstructionMetadata.h"
+#include "Support/Arena.h"
 #include <cstdint>
 #include <cstdio>
+#include <map>
+#include <set>
 #include <vector>
 
 namespace JIT {
 
+/**
+ * The stack effect of a whole function, including the functions that it calls, relative to the stack on entry. This
+ * is only bounded if the effect of every path through the function can be determined statically.
+ */
+class FunctionStackEffect {
+private:
+    bool m_bounded;
+    int m_popCount, m_pushCount;
+    int m_heightDifference;
+
+public:
+    FunctionStackEffect()
+        : m_bounded(false)
+        , m_popCount(0)
+        , m_pushCount(0)
+        , m_heightDifference(0)
+    {
+    }
+
+    FunctionStackEffect(int popCount, int pushCount, int heightDifference)
+        : m_bounded(true)
+        , m_popCount(popCount)
+        , m_pushCount(pushCount)
+        , m_heightDifference(heightDifference)
+    {
+    }
+
+    bool bounded() const { return m_bounded; }
+
+    /// The number of values below the entry height that may be accessed
+    int popCount() const { return m_popCount; }
+
+    /// The maximum number of values above the entry height
+    int pushCount() const { return m_pushCount; }
+
+    /// As for Code::BlockStackEffect, measured at the return instructions
+    int heightDifference() const { return m_heightDifference; }
+
+    Code::BlockStackEffect blockStackEffect() const { return Code::BlockStackEffect(m_popCount, m_pushCount, m_heightDifference); }
+};
+
+/**
+ * An entry in the table of basic blocks built by StaticAnalysis::analyse, so that the compiler doesn't have to iterate
+ * over the bytecode of a block whenever it needs its extent or stack effect. Blocks are referred to by their index in
+ * the table, and offsets are 16-bit as for LinkTable. The analysis fails with BlockTableOverflow if the code or the
+ * table is too large for them, so that NoBlock is never a real index.
+ */
+struct BasicBlockSummary {
+    static const uint16_t NoBlock = UINT16_MAX;
+
+    uint16_t m_start, m_length;
+    Code::BlockStackEffect m_effect;
+
+    /// The start of the function that the block was found in. A block shared by overlapping functions has an entry for each.
+    uint16_t m_function;
+
+    /// The block reached by a jump with a constant destination at the end of the block, or NoBlock
+    uint16_t m_jumpSuccessor;
+
+    /// The block that execution falls through to after a CJMP or an instruction that doesn't branch, or NoBlock
+    uint16_t m_fallThroughSuccessor;
+
+    BasicBlockSummary(Code::Region region, Code::BlockStackEffect effect, size_t function)
+        : m_start((uint16_t)region.start())
+        , m_length((uint16_t)region.length())
+        , m_effect(effect)
+        , m_function((uint16_t)function)
+        , m_jumpSuccessor(NoBlock)
+        , m_fallThroughSuccessor(NoBlock)
+    {
+    }
+
+    Code::Region region() const { return Code::Region(m_start, m_length); }
+};
+
 /**
  * Performs core static analysis of Stack code to categorise regions of code
  */
@@ -26,7 +104,8 @@ public:
         FunctionStartNotTreatedAsBasicBlock,
         VariableJumpNotAllowed,
         IllegalJump,
-        IllegalCall
+        IllegalCall,
+        BlockTableOverflow
     };
     static const char* statusString(Status status);
 
@@ -35,8 +114,10 @@ public:
         , m_metadata(source.length(), InstructionMetadata::Nothing)
         , m_functionRegions(0)
         , m_newFunctionRegions(0)
+        , m_blockIndices(source.length(), BasicBlockSummary::NoBlock)
         , m_hasHalts(false)
         , m_hasDynamicCalls(false)
+        , m_hasComputedJumps(false)
     {
     }
 
@@ -47,9 +128,8 @@ public:
      * then it is skipped. If a contradiction is reached (e.g. jumping/calling what was previously determined to be an
      * illegal location) then static analysis will termiante as normal.
      *
-     * Currently this is O(n) in the length of the code, not just the new instructions that are analysed for the first
-     * time, which is a little annoying. Therefore at the moment it is best to avoid having lots of dynamic calls
-     * because the first time each one is called the *whole* of the code needs to be rechecked.
+     * Only the functions that are found for the first time are verified, so the cost is proportional to the new code
+     * rather than the whole program (other than merging their regions into the sorted list of all functions).
      */
     Status analyse(size_t offset);
 
@@ -60,12 +140,40 @@ public:
     std::vector<Code::Region>& newFunctionRegions() { return m_newFunctionRegions; }
 
     std::vector<Code::Region> basicBlocksForFunction(Code::Region functionRegion) const;
+
+    /// As above, but allocated from |arena| for use during compilation
+    Support::ArenaVector<Code::Region> basicBlocksForFunction(Code::Region functionRegion, Support::Arena& arena) const;
     Code::Region basicBlockAtIndex(int index) const;
 
     Code::BlockStackEffect stackEffectForBasicBlock(Code::Region basicBlock) const;
 
+    const std::vector<BasicBlockSummary>& basicBlockTable() const { return m_blocks; }
+
+    /// The index in the block table of the block starting at |start|, or NoBlock if it hasn't been analysed
+    uint16_t blockIndex(size_t start) const { return start < m_blockIndices.size() ? m_blockIndices[start] : BasicBlockSummary::NoBlock; }
+
+    /**
+     * The entries of the blocks of the function starting at |functionStart|, which are contiguous in the block table.
+     * Returns nullptr if the function hasn't been analysed.
+     */
+    const BasicBlockSummary* blocksForFunction(size_t functionStart, size_t& count) const;
+
+    /**
+     * |functionStart| must be the start of a function. The result is cached, so this is only expensive the first time
+     * it is called for a function (and the functions it calls).
+     */
+    FunctionStackEffect stackEffectForFunction(size_t functionStart);
+
     bool hasHalts() const { return m_hasHalts; }
     bool hasDynamicCalls() const { return m_hasDynamicCalls; }
+    bool hasComputedJumps() const { return m_hasComputedJumps; }
+
+    /**
+     * Used for ComputedJumps. True if a computed jump in the function at |functionStart| may reach code that the
+     * analysis didn't find, as its destination isn't one of the constants that the function pushes. Such a function
+     * can only be interpreted.
+     */
+    bool hasUnprovenComputedJumps(size_t functionStart) const { return m_unprovenComputedJumpFunctions.count(functionStart) > 0; }
 
     /**
      * Returns negative value for the first instruction. The result should be ignored if
@@ -76,12 +184,19 @@ public:
     bool isCallDestination(size_t i) const { return (bool)(m_metadata[i] & InstructionMetadata::FunctionStart); }
     bool isJumpDestination(size_t i) const { return (bool)(m_metadata[i] & InstructionMetadata::BasicBlockStart); }
     bool isCallOrJumpDestination(size_t i) const { return isCallDestination(i) || isJumpDestination(i); }
+    bool isComputedJumpTarget(size_t i) const { return (bool)(m_metadata[i] & InstructionMetadata::ComputedJumpTarget); }
 
     /**
      * NOTE: Under the current compilation approach this actually just means needs to push ONE register, i.e. the LR
      */
     bool functionNeedsToPushRegisters(size_t i) const;
 
+    /// The stack checks that the code is compiled with, which defaults to StackCheckMode
+    void setStackCheckMode(StackCheck mode) { m_stackCheckMode = mode; }
+
+    /// An estimate of the heap memory used by the results of the analysis
+    size_t memoryFootprint() const;
+
     void printStaticAnalyis() const;
 
     void serialise();
@@ -95,16 +210,43 @@ private:
     std::vector<Code::Region> m_functionRegions;
     std::vector<Code::Region> m_newFunctionRegions;
 
+    struct FunctionBlocks {
+        uint16_t m_first, m_count;
+    };
+
+    /// Built for the new functions after each analysis
+    std::vector<BasicBlockSummary> m_blocks;
+    /// For each block start, the index of its first entry in m_blocks. These depend on the order in which functions
+    /// were analysed, which is why LinkTable is keyed by bytecode offset instead.
+    std::vector<uint16_t> m_blockIndices;
+    std::map<size_t, FunctionBlocks> m_functionBlocks;
+
     bool m_hasHalts;
     bool m_hasDynamicCalls;
+    bool m_hasComputedJumps;
+
+    StackCheck m_stackCheckMode = StackCheckMode;
+
+    std::map<size_t, FunctionStackEffect> m_functionStackEffects;
+
+    std::set<size_t> m_unprovenComputedJumpFunctions;
+
+    FunctionStackEffect determineFunctionStackEffect(size_t functionStart);
 
     Status determineCallLocations(size_t offset);
 
-    /**
-     * Currently this method is what causes static analysis to always be O(n) in the length of the code :( as per above
-     */
-    Status verifyInstructionMetadata() const;
+    /// Checks the metadata in |region|, which must include every instruction whose metadata has changed
+    Status verifyInstructionMetadata(Code::Region region) const;
 
     void dumpRegions() const;
+
+    /// Adds the blocks of |functions| to the block table. Fails if an offset or index doesn't fit in 16 bits.
+    Status buildBlockTable(const std::vector<Code::Region>& functions);
+
+    /// The entry in the block table for exactly |basicBlock|, if there is one
+    const BasicBlockSummary* blockSummary(Code::Region basicBlock) const;
+
+    template <typename Blocks>
+    void appendBasicBlocks(Code::Region functionRegion, Blocks& blocks) const;
 };
 }
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "StrengthReduction.h"
+
+#include "CodeGen.h"
+
+namespace JIT {
+
+static bool isPowerOfTwo(uint32_t x)
+{
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+static uint8_t logBase2(uint32_t x)
+{
+    uint8_t log = 0;
+    while (x >>= 1) {
+        ++log;
+    }
+    return log;
+}
+
+static bool hasTwoBitsSet(uint32_t x)
+{
+    return x != 0 && isPowerOfTwo(x & (x - 1));
+}
+
+DivisionMagic divisionMagic(int32_t divisor)
+{
+    const uint32_t two31 = 0x80000000;
+    uint32_t absDivisor = divisor < 0 ? 0 - (uint32_t)divisor : (uint32_t)divisor;
+    uint32_t t = two31 + ((uint32_t)divisor >> 31);
+    uint32_t absNc = t - 1 - t % absDivisor;
+    int p = 31;
+    uint32_t q1 = two31 / absNc;
+    uint32_t r1 = two31 - q1 * absNc;
+    uint32_t q2 = two31 / absDivisor;
+    uint32_t r2 = two31 - q2 * absDivisor;
+    uint32_t delta;
+    do {
+        ++p;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= absNc) {
+            ++q1;
+            r1 -= absNc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= absDivisor) {
+            ++q2;
+            r2 -= absDivisor;
+        }
+        delta = absDivisor - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    DivisionMagic magic;
+    magic.m_multiplier = (int32_t)(q2 + 1);
+    if (divisor < 0) {
+        magic.m_multiplier = -magic.m_multiplier;
+    }
+    magic.m_shift = p - 32;
+    return magic;
+}
+
+static void compileMultiplyByConstant(ARM::Functor& func, ARM::Register destination, ARM::Register value, uint32_t multiplier)
+{
+    if (multiplier == 0) {
+        func.add(ARM::moveImmediate(destination, 0));
+    } else if (multiplier == 1) {
+        func.add(ARM::moveLowToLow(destination, value));
+    } else if (multiplier == 0xFFFFFFFF) {
+        func.add(ARM::neg(destination, value));
+    } else if (isPowerOfTwo(multiplier)) {
+        func.add(ARM::logicalShiftLeftImmediate(destination, value, logBase2(multiplier)));
+    } else if (isPowerOfTwo(0 - multiplier)) {
+        func.add(ARM::logicalShiftLeftImmediate(TempRegister, value, logBase2(0 - multiplier)));
+        func.add(ARM::neg(destination, TempRegister));
+    } else if (isPowerOfTwo(multiplier - 1)) {
+        func.add(ARM::logicalShiftLeftImmediate(TempRegister, value, logBase2(multiplier - 1)));
+        func.add(ARM::addReg(destination, TempRegister, value));
+    } else if (isPowerOfTwo(multiplier + 1)) {
+        func.add(ARM::logicalShiftLeftImmediate(TempRegister, value, logBase2(multiplier + 1)));
+        func.add(ARM::subReg(destination, TempRegister, value));
+    } else {
+        // Two bits set: value * (2^high + 2^low) == ((value << (high - low)) + value) << low
+        auto low = logBase2(multiplier & (0 - multiplier));
+        auto high = logBase2(multiplier);
+        func.add(ARM::logicalShiftLeftImmediate(TempRegister, value, high - low));
+        func.add(ARM::addReg(TempRegister, TempRegister, value));
+        if (low > 0) {
+            func.add(ARM::logicalShiftLeftImmediate(destination, TempRegister, low));
+        } else {
+            func.add(ARM::moveLowToLow(destination, TempRegister));
+        }
+    }
+}
+
+/// Signed division rounds towards zero, so negative dividends are biased by |divisor| - 1 before shifting
+static void compileDivideByPowerOfTwo(ARM::Functor& func, ARM::Register destination, ARM::Register value, int32_t divisor, bool modulo)
+{
+    auto shift = logBase2(divisor < 0 ? 0 - (uint32_t)divisor : (uint32_t)divisor);
+    if (shift == 1) {
+        func.add(ARM::logicalShiftRightImmediate(TempRegister, value, 31));
+    } else {
+        func.add(ARM::arithmeticShiftRightImm(TempRegister, value, 31));
+        func.add(ARM::logicalShiftRightImmediate(TempRegister, TempRegister, 32 - shift));
+    }
+    func.add(ARM::addReg(TempRegister, TempRegister, value));
+
+    if (modulo) {
+        // The remainder takes the sign of the dividend, so the sign of the divisor doesn't matter
+        func.add(ARM::logicalShiftRightImmediate(TempRegister, TempRegister, shift));
+        func.add(ARM::logicalShiftLeftImmediate(TempRegister, TempRegister, shift));
+        func.add(ARM::subReg(destination, value, TempRegister));
+    } else if (divisor > 0) {
+        func.add(ARM::arithmeticShiftRightImm(destination, TempRegister, shift));
+    } else {
+        func.add(ARM::arithmeticShiftRightImm(TempRegister, TempRegister, shift));
+        func.add(ARM::neg(destination, TempRegister));
+    }
+}
+
+/**
+ * The Cortex-M0 has no long multiply, so the high word of the product of the dividend and the magic multiplier is
+ * built from four 16-bit products, as in Hacker's Delight section 8-2
+ */
+static void compileDivideByMagic(ARM::Functor& func, ARM::Register destination, ARM::Register value, int32_t divisor, bool modulo)
+{
+    auto magic = divisionMagic(divisor);
+    int32_t multiplierLow = magic.m_multiplier & 0xFFFF;
+    int32_t multiplierHigh = magic.m_multiplier >> 16;
+
+    const auto a = TempRegister;
+    const auto b = ARM::Register::r4;
+    const auto c = ARM::Register::r5;
+    const auto d = ARM::Register::r6;
+
+    // The dividend is kept in HelperOperandRegister, as |value| may be one of the saved registers
+    func.add(ARM::moveGeneral(HelperOperandRegister, value));
+    func.add(ARM::pushMultiple(false, ARM::RegisterList::r4 | ARM::RegisterList::r5 | ARM::RegisterList::r6));
+    func.add(ARM::moveGeneral(a, HelperOperandRegister));
+    // b := low half of the dividend, a := high half of the dividend
+    func.add(ARM::logicalShiftLeftImmediate(b, a, 16));
+    func.add(ARM::logicalShiftRightImmediate(b, b, 16));
+    func.add(ARM::arithmeticShiftRightImm(a, a, 16));
+    // c := (low * multiplierLow) >> 16, unsigned
+    compileLoadConstant(func, multiplierLow, c);
+    func.add(ARM::mul(c, b));
+    func.add(ARM::logicalShiftRightImmediate(c, c, 16));
+    // c := c + high * multiplierLow
+    compileLoadConstant(func, multiplierLow, d);
+    func.add(ARM::mul(d, a));
+    func.add(ARM::addReg(c, c, d));
+    // d := low * multiplierHigh + (c & 0xFFFF)
+    compileLoadConstant(func, multiplierHigh, d);
+    func.add(ARM::mul(d, b));
+    func.add(ARM::logicalShiftLeftImmediate(b, c, 16));
+    func.add(ARM::logicalShiftRightImmediate(b, b, 16));
+    func.add(ARM::addReg(d, d, b));
+    // c := (c >> 16) + (d >> 16)
+    func.add(ARM::arithmeticShiftRightImm(d, d, 16));
+    func.add(ARM::arithmeticShiftRightImm(c, c, 16));
+    func.add(ARM::addReg(c, c, d));
+    // a := high * multiplierHigh + c, the high word of the product
+    compileLoadConstant(func, multiplierHigh, d);
+    func.add(ARM::mul(d, a));
+    func.add(ARM::addReg(a, c, d));
+
+    if (divisor > 0 && magic.m_multiplier < 0) {
+        func.add(ARM::addGeneral(a, HelperOperandRegister));
+    } else if (divisor < 0 && magic.m_multiplier > 0) {
+        func.add(ARM::moveGeneral(d, HelperOperandRegister));
+        func.add(ARM::subReg(a, a, d));
+    }
+    if (magic.m_shift > 0) {
+        func.add(ARM::arithmeticShiftRightImm(a, a, magic.m_shift));
+    }
+    // Round towards zero by adding one to negative quotients
+    func.add(ARM::logicalShiftRightImmediate(d, a, 31));
+    func.add(ARM::addReg(a, a, d));
+
+    if (modulo) {
+        compileLoadConstant(func, divisor, d);
+        func.add(ARM::mul(a, d));
+        func.add(ARM::moveGeneral(d, HelperOperandRegister));
+        func.add(ARM::subReg(a, d, a));
+    }
+
+    func.add(ARM::popMultiple(false, ARM::RegisterList::r4 | ARM::RegisterList::r5 | ARM::RegisterList::r6));
+    func.add(ARM::moveLowToLow(destination, a));
+}
+
+bool canStrengthReduce(Code::Instruction instr, int32_t operand)
+{
+    uint32_t x = (uint32_t)operand;
+    switch (instr) {
+    case Code::Instruction::Mul:
+        return x == 0 || isPowerOfTwo(x) || isPowerOfTwo(0 - x) || isPowerOfTwo(x - 1) || isPowerOfTwo(x + 1) || hasTwoBitsSet(x);
+    case Code::Instruction::Div:
+    case Code::Instruction::Mod:
+        // The smallest integer is the only divisor whose absolute value can't be represented
+        return x != 0x80000000;
+    default:
+        return false;
+    }
+}
+
+void compileStrengthReducedOp(ARM::Functor& func, Code::Instruction instr, ARM::Register destination, ARM::Register value, int32_t operand)
+{
+    if (instr == Code::Instruction::Mul) {
+        compileMultiplyByConstant(func, destination, value, (uint32_t)operand);
+        return;
+    }
+
+    auto modulo = instr == Code::Instruction::Mod;
+    uint32_t absDivisor = operand < 0 ? 0 - (uint32_t)operand : (uint32_t)operand;
+    if (operand == 0) {
+        // Matches divide and modulo
+        if (modulo) {
+            func.add(ARM::moveLowToLow(destination, value));
+        } else {
+            func.add(ARM::moveImmediate(destination, 0));
+        }
+    } else if (absDivisor == 1) {
+        if (modulo) {
+            func.add(ARM::moveImmediate(destination, 0));
+        } else if (operand == 1) {
+            func.add(ARM::moveLowToLow(destination, value));
+        } else {
+            func.add(ARM::neg(destination, value));
+        }
+    } else if (isPowerOfTwo(absDivisor)) {
+        compileDivideByPowerOfTwo(func, destination, value, operand, modulo);
+    } else {
+        compileDivideByMagic(func, destination, value, operand, modulo);
+    }
+}
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Config.h"
+
+#include "ARM/Functor.h"
+#include "Code/Instruction.h"
+
+namespace JIT {
+
+/// The multiplier and shift that replace signed division by a constant with a multiplication by its reciprocal
+struct DivisionMagic {
+    int32_t m_multiplier;
+    int m_shift;
+};
+
+/**
+ * From Hacker's Delight (Warren, 2nd edition, section 10-4). |divisor| must not be -1, 0, 1, or the smallest integer.
+ */
+DivisionMagic divisionMagic(int32_t divisor);
+
+/**
+ * Used for StrengthReduction. Returns true if |instr| can be compiled without MUL or a call to the division routine
+ * when |operand| is known, which is either operand of Mul but only the divisor of Div and Mod.
+ */
+bool canStrengthReduce(Code::Instruction instr, int32_t operand);
+
+/**
+ * Emits |instr| on |value| and the constant |operand| into |destination|, which may be the same register as |value|.
+ * Clobbers TempRegister and HelperOperandRegister; division by a constant that isn't a power of two also uses r4-r6,
+ * which are saved on the machine stack around it.
+ */
+void compileStrengthReducedOp(ARM::Functor& func, Code::Instruction instr, ARM::Register destination, ARM::Register value, int32_t operand);
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "TieredExecution.h"
+
+#include <cstdio>
+
+namespace JIT {
+
+bool TieredExecution::countAndCompile(int functionStart)
+{
+    // Calling the stub would just return to the interpreter
+    if (m_compiler.isInterpretedFunction(functionStart)) {
+        return false;
+    }
+    if (m_compiler.functionPointerForStackFunction(m_functor, functionStart)) {
+        return true;
+    }
+    if (m_failed || ++m_counters[functionStart] < TieredCompilationThreshold) {
+        return false;
+    }
+
+    if (!m_hasEntryCode) {
+        auto status = m_compiler.compileIndirectEntry(m_functor);
+        if (status != Compiler::Status::Success) {
+            printf("Tiered entry code failed to compile: %s\n", Compiler::statusString(status));
+            m_failed = true;
+            return false;
+        }
+        m_hasEntryCode = true;
+    }
+
+    auto status = m_compiler.compileNewFunction(m_functor, functionStart);
+    if (status != Compiler::Status::Success) {
+        printf("Function at %d failed to compile: %s\n", functionStart, Compiler::statusString(status));
+        m_failed = true;
+        return false;
+    }
+    if (AlwaysPrintCompilation) {
+        m_compiler.prettyPrintCode(m_functor);
+    }
+    m_counters.erase(functionStart);
+    return true;
+}
+
+Environment::VMFunction TieredExecution::functionForCall(int functionStart)
+{
+    if (!countAndCompile(functionStart)) {
+        return nullptr;
+    }
+    return m_compiler.functionPointerForStackFunction(m_functor, functionStart);
+}
+
+bool TieredExecution::recordBackEdge(int functionStart)
+{
+    return countAndCompile(functionStart);
+}
+
+bool TieredExecution::replaceOnBackEdge(Environment::VM** state, int functionStart, int32_t** stackPointer, int32_t* topOfStack)
+{
+    if (!recordBackEdge(functionStart)) {
+        return false;
+    }
+
+    Environment::VMFunction blockEntry = nullptr;
+    auto entry = m_compiler.onStackReplacementEntry(m_functor, functionStart, (*state)->m_programCounter, blockEntry);
+    if (!entry) {
+        return false;
+    }
+
+    auto previousBlock = (*state)->m_nativeEntryBlock;
+    (*state)->m_nativeEntryBlock = blockEntry;
+    *state = callNative(*state, entry, stackPointer, topOfStack);
+    (*state)->m_nativeEntryBlock = previousBlock;
+    return true;
+}
+
+Environment::VM* TieredExecution::callNative(Environment::VM* state, Environment::VMFunction function, int32_t** stackPointer, int32_t* topOfStack)
+{
+    // Same as the Ret instruction in the interpreter
+    if (*stackPointer != state->m_stack.m_end) {
+        **stackPointer = *topOfStack;
+    }
+    state->m_stack.m_stackPointer = *stackPointer;
+
+    // The entry code overwrites these, which matters if the interpreter was itself called from native code
+    auto escapeStackAddress = state->m_escapeStackAddress;
+    auto entryFunction = state->m_nativeEntryFunction;
+    auto programCounter = state->m_programCounter;
+
+    state->m_nativeEntryFunction = function;
+    state = state->call(m_functor);
+
+    state->m_escapeStackAddress = escapeStackAddress;
+    state->m_nativeEntryFunction = entryFunction;
+    if (state->m_programCounter == Compiler::HaltedProgramCounter) {
+        state->m_programCounter = state->m_code.length();
+    } else {
+        state->m_programCounter = programCounter;
+    }
+
+    // Same as doFunc in the interpreter
+    *stackPointer = state->m_stack.m_stackPointer;
+    if (*stackPointer != state->m_stack.m_end) {
+        *topOfStack = **stackPointer;
+    }
+    return state;
+}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Config.h"
+
+#include "ARM/Functor.h"
+#include "Compiler.h"
+#include "Environment/VM.h"
+#include <map>
+
+namespace JIT {
+
+/**
+ * Used by the interpreter for tiered execution. Counts the calls and back edges of each function that is interpreted
+ * and compiles it once this reaches TieredCompilationThreshold. The compiler and functor must outlive this object and
+ * the functor must be empty initially, as the entry code is compiled at the start of it.
+ */
+class TieredExecution {
+public:
+    TieredExecution(Compiler& compiler, ARM::Functor& functor)
+        : m_compiler(compiler)
+        , m_functor(functor)
+        , m_hasEntryCode(false)
+        , m_failed(false)
+    {
+    }
+
+    /**
+     * Returns the native code to call for the function at |functionStart|, or nullptr if it should be interpreted
+     */
+    Environment::VMFunction functionForCall(int functionStart);
+
+    /**
+     * Returns true if the function at |functionStart| has been compiled
+     */
+    bool recordBackEdge(int functionStart);
+
+    /**
+     * Called after the interpreter has taken a back edge in the function at |functionStart|. Once the function has
+     * been compiled the rest of its execution moves to the native code for the block at the program counter (on-stack
+     * replacement). In this case true is returned and the interpreter should return as if the function had returned.
+     */
+    bool replaceOnBackEdge(Environment::VM** state, int functionStart, int32_t** stackPointer, int32_t* topOfStack);
+
+    /**
+     * Calls |function| with the interpreter's stack, which is updated afterwards. The program counter is set to the end
+     * of the code if the native code halted, otherwise it is unchanged.
+     */
+    Environment::VM* callNative(Environment::VM* state, Environment::VMFunction function, int32_t** stackPointer, int32_t* topOfStack);
+
+private:
+    Compiler& m_compiler;
+    ARM::Functor& m_functor;
+    std::map<int, int> m_counters;
+    bool m_hasEntryCode;
+    /// Compilation failures leave the compiler in an unknown state, so no further compilation is attempted
+    bool m_failed;
+
+    bool countAndCompile(int functionStart);
+};
+}
\ No newline at end of file
@@ -9,9 +9,8 @@ size_t UnconditionalBranch::instructionCount()
 
 bool UnconditionalBranch::linkStackCode(ARM::Functor& func, size_t realDestinationOffset)
 {
-    uint16_t* buffer = func.buffer();
     int i = insertionOffset();
-    buffer[i] = ARM::unconditionalBranchNatural((int)realDestinationOffset - i);
+    *func.address(i) = ARM::unconditionalBranchNatural(func.distance(i, realDestinationOffset));
     return true;
 }
 }
\ No newline at end of file
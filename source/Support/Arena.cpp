@@ -0,0 +1,53 @@
+#include "Arena.h"
+
+#include "MicroBit.h"
+#include <cstdio>
+#include <cstdlib>
+
+namespace Support {
+
+Arena::~Arena()
+{
+    reset();
+}
+
+void Arena::addBlock(size_t minimumCapacity)
+{
+    size_t capacity = minimumCapacity > BlockSize ? minimumCapacity : BlockSize;
+    auto block = (Block*)malloc(sizeof(Block) + capacity);
+    if (!block) {
+        printf("ERROR: Arena failed to allocate %d bytes\n", (int)(sizeof(Block) + capacity));
+        microbit_panic(MICROBIT_OOM);
+    }
+    block->m_previous = m_current;
+    block->m_capacity = capacity;
+    m_current = block;
+    m_used = 0;
+    m_heapBytes += sizeof(Block) + capacity;
+    if (m_heapBytes > m_peakHeapBytes) {
+        m_peakHeapBytes = m_heapBytes;
+    }
+}
+
+void* Arena::allocate(size_t size)
+{
+    size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    if (!m_current || m_used + size > m_current->m_capacity) {
+        addBlock(size);
+    }
+    void* memory = dataOf(m_current) + m_used;
+    m_used += size;
+    return memory;
+}
+
+void Arena::reset()
+{
+    while (m_current) {
+        auto previous = m_current->m_previous;
+        free(m_current);
+        m_current = previous;
+    }
+    m_used = 0;
+    m_heapBytes = 0;
+}
+}
\ No newline at end of file
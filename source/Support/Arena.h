@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Config.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Support {
+
+/**
+ * A bump allocator for data that only lives until the end of a compilation. Memory is taken from the heap in blocks of
+ * BlockSize bytes and individual allocations are never freed; instead reset returns every block at once. Most blocks are
+ * BlockSize bytes, so the holes that they leave in the heap can be reused by the next compilation. A larger allocation,
+ * such as an ArenaVector growing past BlockSize bytes, gets a block of its own size, which can leave a hole that a
+ * later compilation can't fill. Reserving a container's capacity up front avoids the blocks that its doubling leaves
+ * behind, as StaticAnalysis::basicBlocksForFunction does.
+ *
+ * Like Queue this uses malloc and free directly, as the micro:bit allocator doesn't support delete[]. Unlike Queue,
+ * running out of heap is fatal: containers can't be told that their storage failed to allocate, so the arena panics
+ * as the micro:bit allocator does for new.
+ */
+class Arena {
+private:
+    struct Block {
+        Block* m_previous;
+        size_t m_capacity;
+    };
+
+    Block* m_current = nullptr;
+    size_t m_used = 0;
+    size_t m_heapBytes = 0;
+    size_t m_peakHeapBytes = 0;
+
+    static uint8_t* dataOf(Block* block) { return (uint8_t*)(block + 1); }
+
+    /// Allocates a block of BlockSize bytes, or of |minimumCapacity| bytes if that is larger. Panics if the heap is
+    /// exhausted.
+    void addBlock(size_t minimumCapacity);
+
+public:
+    static const size_t BlockSize = 512;
+
+    Arena() {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena();
+
+    /// Word aligned. Never returns nullptr, as this panics if the heap is exhausted.
+    void* allocate(size_t size);
+
+    /// Frees every allocation. Objects allocated with create must have been destroyed first.
+    void reset();
+
+    /// The number of bytes currently taken from the heap
+    size_t heapBytes() const { return m_heapBytes; }
+
+    /// The most bytes taken from the heap at once since the arena was created
+    size_t peakHeapBytes() const { return m_peakHeapBytes; }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        return new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+    }
+};
+
+/// Destroys but doesn't free an object from Arena::create, so that it can be owned by a std::unique_ptr
+struct ArenaDeleter {
+    template <typename T>
+    void operator()(T* object) const { object->~T(); }
+};
+
+template <typename T>
+using ArenaPtr = std::unique_ptr<T, ArenaDeleter>;
+
+/**
+ * Allocates the storage of standard containers from an Arena. Deallocating is a no-op, so containers should be sized
+ * up front where possible, as each time that they grow their previous storage is wasted until the arena is reset.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    Arena* m_arena;
+
+    ArenaAllocator(Arena& arena)
+        : m_arena(&arena)
+    {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : m_arena(other.m_arena)
+    {
+    }
+
+    T* allocate(size_t n) { return (T*)m_arena->allocate(n * sizeof(T)); }
+
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return m_arena == other.m_arena; }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return m_arena != other.m_arena; }
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}
\ No newline at end of file
@@ -94,6 +94,7 @@ bool testDecoder()
     res &= testDecoder(loadSignedByteWithRegisterOffset(Register::r0, Register::r3, Register::r7), "ldrsb r0, [r3, r7]");
     res &= testDecoder(loadSignedHalfWordWithRegisterOffset(Register::r0, Register::r3, Register::r7), "ldrsh r0, [r3, r7]");
     res &= testDecoder(logicalShiftLeftImmediate(Register::r3, Register::r7, 27), "lsl r3, r7, #27");
+    res &= testDecoder(logicalShiftRightImmediate(Register::r2, Register::r5, 9), "lsr r2, r5, #9");
     res &= testDecoder(leftShiftLogicalRegister(Register::r0, Register::r1), "lsl r0, r1");
     res &= testDecoder(rightShiftLogicalRegister(Register::r0, Register::r1), "lsr r0, r1");
     res &= testDecoder(moveImmediate(Register::r0, 42), "mov r0, #42");
@@ -780,6 +780,30 @@ bool testLongCallIntoC()
     return func.call<int, int>(42) == 43;
 }
 
+bool testCallBetweenSegments()
+{
+    Functor func;
+    func.add(pushMultiple(true, RegisterList::empty));
+    auto call = func.length();
+    func.add(nop());
+    func.add(nop());
+    func.add(popMultiple(true, RegisterList::empty));
+    func.seal();
+    auto caller = func.buffer();
+
+    auto callee = func.length();
+    func.add(addSmallImm(Register::r0, Register::r0, 1));
+    func.add(ret());
+    func.seal();
+
+    auto pair = branchAndLinkNatural(func.distance(call, callee));
+    func.address(call)[0] = pair.instruction1;
+    func.address(call)[1] = pair.instruction2;
+    func.commit();
+
+    return func.buffer() == caller && func.call<int, int>(42) == 43;
+}
+
 /**
  * Test framework
  */
@@ -870,6 +894,7 @@ bool testEncoder()
     success &= TEST(testNop);
     success &= TEST(testReturn);
     success &= TEST(testLongCallIntoC);
+    success &= TEST(testCallBetweenSegments);
 
     return success;
 }
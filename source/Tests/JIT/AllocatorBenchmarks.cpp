@@ -0,0 +1,66 @@
+#include "Tests.h"
+
+#include "Device/MicroBitDevice.h"
+#include "Device/OptionalInstructions.h"
+#include "JIT/Compiler.h"
+#include "JIT/DynamicCompilation.h"
+#include "MarksExecutionTests.h"
+#include "Support/Memory.h"
+#include "Tests/Utilities.h"
+#include <cstdio>
+
+namespace JIT {
+
+static const int BenchmarkStackDepth = 128;
+
+/**
+ * Compiles |code| with |allocation| and reports the size of the generated code. The compiled code is then executed
+ * |TestExecutionCount| times between the compiler timing signals, so that the cycle count can be measured on the
+ * NeoPixel pin in the same way as the other profiling tests (the Cortex-M0 has no cycle counter).
+ */
+static void benchmarkRegisterAllocator(const char* name, Code::Array code, RegisterAllocation allocation)
+{
+    int32_t stackStorage[BenchmarkStackDepth];
+    Environment::Stack stack(stackStorage, BenchmarkStackDepth);
+    Environment::VM state(stack, code);
+    state.m_compileOrInterpretFunction = (Environment::VMFunction)&JIT::compileFunctionDynamically;
+
+    ARM::Functor func;
+    auto compiler = Support::make_unique<JIT::Compiler>(state.m_code, &Device::MicroBitDevice::singleton(), allocation);
+    state.m_compiler = compiler.get();
+    auto result = compiler->compile(func);
+
+    if (result != Compiler::Status::Success) {
+        printf("%s with %s: compilation error %s\n", name, RegisterAllocation_Strings[(int)allocation], Compiler::statusString(result));
+        return;
+    }
+
+    Device::sendStartTimingCompilerSignal();
+    for (int i = 0; i < TestExecutionCount; ++i) {
+        state.reset();
+        state.m_stack.clear();
+        state.call(func);
+    }
+    Device::sendEndTimingCompilerSignal();
+
+    printf("%s with %s: %d bytes, %d peak arena bytes, status %s\n", name, RegisterAllocation_Strings[(int)allocation], (int)func.length() * 2, (int)compiler->peakArenaBytes(), Environment::VMStatusString(state.m_status));
+    auto& usage = compiler->peakMemoryUsage();
+    printf("%s with %s: peak memory %d bytes analysing, %d generating code, %d linking\n", name, RegisterAllocation_Strings[(int)allocation], (int)usage.m_analysisBytes, (int)usage.m_codeGenerationBytes, (int)usage.m_linkingBytes);
+}
+
+static void benchmarkRegisterAllocators(const char* name, Code::Array code)
+{
+    benchmarkRegisterAllocator(name, code, RegisterAllocation::StackWithCopyOnWrite);
+    benchmarkRegisterAllocator(name, code, RegisterAllocation::StackScheduling);
+}
+
+void benchmarkRegisterAllocators()
+{
+    printTestHeader("REGISTER ALLOCATOR BENCHMARKS");
+
+    benchmarkRegisterAllocators("MarksEnum", Code::Array(EnumTestCode, EnumTestCodeLength));
+    benchmarkRegisterAllocators("MarksLinkTest2", Code::Array(LinkTest2Code, LinkTest2Length));
+    benchmarkRegisterAllocators("MarksLoopExit", Code::Array(LoopExitTestCode, LoopExitTestLength));
+    // MarksUsing is disabled for the same reason as in ExecutionTests.cpp
+}
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "Device/MicroBitDevice.h"
 #include "JIT/Compiler.h"
+#include "JIT/DynamicCompilation.h"
 #include "Tests/Utilities.h"
 
 namespace JIT {
@@ -34,12 +35,55 @@ bool testObservers()
     return success;
 }
 
+static const Code::Instruction memoryBudgetCode[] = {
+    // 0: Call 7 twice
+    Code::Instruction::Push8, (Code::Instruction)7, Code::Instruction::Call,
+    Code::Instruction::Push8, (Code::Instruction)7, Code::Instruction::Call,
+    // 6
+    Code::Instruction::Ret,
+    // 7: Mul by 3
+    Code::Instruction::Push8, (Code::Instruction)3, Code::Instruction::Mul,
+    // 10
+    Code::Instruction::Ret
+};
+
+/// Returns the top of the stack after running memoryBudgetCode on 2, compiled with |memoryBudget|
+static int runWithMemoryBudget(size_t memoryBudget, bool& interpreted)
+{
+    int32_t stackStorage[16];
+    Environment::Stack stack(stackStorage, 16);
+    Environment::VM state(stack, Code::Array(memoryBudgetCode, sizeof(memoryBudgetCode)));
+    state.m_compileOrInterpretFunction = (Environment::VMFunction)&JIT::compileFunctionDynamically;
+
+    ARM::Functor func;
+    JIT::Compiler compiler(state.m_code, &Device::MicroBitDevice::singleton(), RegisterAllocationMode, memoryBudget);
+    state.m_compiler = &compiler;
+    if (compiler.compile(func) != JIT::Compiler::Status::Success || compiler.peakMemoryUsage().m_codeGenerationBytes == 0) {
+        return -1;
+    }
+    interpreted = compiler.isInterpretedFunction(7);
+
+    state.m_stack.push(2);
+    state.call(func);
+    return state.m_stack.size() == 1 ? state.m_stack.peek() : -1;
+}
+
+bool testMemoryBudget()
+{
+    bool interpreted = false;
+    bool success = runWithMemoryBudget(0, interpreted) == 18 && !interpreted;
+    // A budget of one byte can never be met, so every strategy is stepped down until both functions are interpreted
+    success &= runWithMemoryBudget(1, interpreted) == 18 && interpreted;
+    return success;
+}
+
 bool testCompiler()
 {
     printTestHeader("COMPILER INFRASTRUCTURE TESTS");
     bool success = true;
 
     success &= TEST(testObservers);
+    success &= TEST(testMemoryBudget);
 
     return success;
 }
@@ -6,6 +6,7 @@
 #include "JIT/Compiler.h"
 #include "JIT/DynamicCompilation.h"
 #include "JIT/Interpreter.h"
+#include "JIT/TieredExecution.h"
 #include "MarksExecutionTests.h"
 #include "Support/Memory.h"
 #include "Tests/Utilities.h"
@@ -22,6 +23,8 @@ public:
     // If in fuzzed mode the stack will be cleared before this is called and filled with the fuzz test values
     virtual void preTest(Environment::VM& state) = 0;
     virtual bool postTest(Environment::VM& state) = 0;
+    // Called with each compiler before it compiles the code
+    virtual void configureCompiler(JIT::Compiler& compiler) {}
 
     CodeTest(const Code::Instruction* code, int32_t length)
         : stack(stackStorage, sizeof(stackStorage) / sizeof(int32_t))
@@ -154,6 +157,7 @@ bool CodeTest::correctnessTest()
     // Strictly this doesn't need to be a unique pointer but I might later take advantage of that
     auto compiler = Support::make_unique<JIT::Compiler>(state.m_code, &Device::MicroBitDevice::singleton());
     state.m_compiler = compiler.get();
+    configureCompiler(*compiler);
     auto result = compiler->compile(func);
 
     bool compileSuccess = false;
@@ -194,7 +198,29 @@ bool CodeTest::correctnessTest()
         printf("Compilation error: %s\n", Compiler::statusString(result));
     }
 
-    return interpretSuccess && invariantsHold && compileSuccess;
+    bool tieredSuccess = true;
+    if (TieredCompilation) {
+        configureCanaryValues(state);
+        preTest(state);
+        state.reset();
+        ARM::Functor tieredFunc;
+        JIT::Compiler tieredCompiler(state.m_code, &Device::MicroBitDevice::singleton());
+        configureCompiler(tieredCompiler);
+        TieredExecution tieredExecution(tieredCompiler, tieredFunc);
+        state.m_compiler = &tieredCompiler;
+        state.m_tieredExecution = &tieredExecution;
+        execute(&state);
+        state.m_tieredExecution = nullptr;
+        state.m_compiler = nullptr;
+
+        tieredSuccess = verifyCanaryValuesAreInTact(state) && postTest(state);
+        if (!tieredSuccess) {
+            printf("Tiered execution failure (state is %s) at %ld, end stack state:\n", VMStatusString(state.m_status), state.m_programCounter);
+            state.m_stack.print();
+        }
+    }
+
+    return interpretSuccess && invariantsHold && compileSuccess && tieredSuccess;
 }
 
 void CodeTest::performanceTest()
@@ -225,6 +251,7 @@ void CodeTest::performanceTest()
     ARM::Functor func;
     auto compiler = Support::make_unique<JIT::Compiler>(state.m_code, &Device::MicroBitDevice::singleton());
     state.m_compiler = compiler.get();
+    configureCompiler(*compiler);
     auto result = compiler->compile(func);
 
     // Round 2a: Timing for compiler set up
@@ -380,6 +407,66 @@ private:
     int m_expected;
 };
 
+/**
+ * Performs a + (b OP a), where a is only known at runtime and is kept on the stack whilst OP is performed
+ */
+class PreservedOperandTest : public CodeTest {
+public:
+    PreservedOperandTest(Code::Instruction instr, int a, int8_t b, int expected)
+        : CodeTest(&m_code[0], sizeof(m_code) / sizeof(Code::Instruction))
+        , m_code{ Code::Instruction::Dup, Code::Instruction::Push8, (Code::Instruction)b, Code::Instruction::Swap, instr, Code::Instruction::Add }
+        , m_a(a)
+        , m_expected(expected)
+    {
+    }
+
+    void preTest(Environment::VM& state)
+    {
+        clearIfNotInCanaryMode(state);
+        state.m_stack.push(m_a);
+    }
+
+    bool postTest(Environment::VM& state)
+    {
+        return state.m_stack.size() == 1 + numberOfCanaryValues() && state.m_stack.peek() == m_expected;
+    }
+
+private:
+    Code::Instruction m_code[6];
+    int m_a;
+    int m_expected;
+};
+
+/**
+ * Performs a OP b, where only b is known at compile time
+ */
+class ConstantOperandTest : public CodeTest {
+public:
+    ConstantOperandTest(Code::Instruction instr, int a, int8_t b, int expected)
+        : CodeTest(&m_code[0], sizeof(m_code) / sizeof(Code::Instruction))
+        , m_code{ Code::Instruction::Push8, (Code::Instruction)b, instr }
+        , m_a(a)
+        , m_expected(expected)
+    {
+    }
+
+    void preTest(Environment::VM& state)
+    {
+        clearIfNotInCanaryMode(state);
+        state.m_stack.push(m_a);
+    }
+
+    bool postTest(Environment::VM& state)
+    {
+        return state.m_stack.size() == 1 + numberOfCanaryValues() && state.m_stack.peek() == m_expected;
+    }
+
+private:
+    Code::Instruction m_code[3];
+    int m_a;
+    int m_expected;
+};
+
 class DupTest : public SingleInstructionTest {
 public:
     DupTest()
@@ -717,6 +804,87 @@ private:
     int16_t value;
 };
 
+/// Pushes two constants, where the register allocator may derive the second from the first
+class NearbyConstantsTest : public CodeTest {
+public:
+    NearbyConstantsTest(int16_t a, int16_t b)
+        : CodeTest((const Code::Instruction*)instructions, 6)
+        , a(a)
+        , b(b)
+    {
+        instructions[0] = Code::Instruction::Push16;
+        instructions[1] = (Code::Instruction)((unsigned)a & 0xFF);
+        instructions[2] = (Code::Instruction)((unsigned)a >> 8);
+        instructions[3] = Code::Instruction::Push16;
+        instructions[4] = (Code::Instruction)((unsigned)b & 0xFF);
+        instructions[5] = (Code::Instruction)((unsigned)b >> 8);
+    }
+
+    void preTest(Environment::VM& state)
+    {
+        clearIfNotInCanaryMode(state);
+    }
+
+    bool postTest(Environment::VM& state)
+    {
+        return state.m_stack.size() == 2 + numberOfCanaryValues() && state.m_stack.peek() == b && state.m_stack.peek(1) == a;
+    }
+
+private:
+    Code::Instruction instructions[6];
+    int16_t a;
+    int16_t b;
+};
+
+/**
+ * Sums many distinct constants that are expensive to build, across two basic blocks that are each long enough that
+ * their literal pools have to be split
+ */
+class ManyLargeConstantsTest : public CodeTest {
+public:
+    ManyLargeConstantsTest()
+        : CodeTest((const Code::Instruction*)instructions, Length)
+        , sum(0)
+    {
+        size_t i = 0;
+        for (int c = 0; c < Count; ++c) {
+            if (c == Count / 2) {
+                // Jump to the next instruction, so that a pool can be placed between the blocks
+                auto destination = i + 4;
+                instructions[i++] = Code::Instruction::Push16;
+                instructions[i++] = (Code::Instruction)(destination & 0xFF);
+                instructions[i++] = (Code::Instruction)(destination >> 8);
+                instructions[i++] = Code::Instruction::Jmp;
+            }
+            // Odd negative values mostly take more than three instructions to build, so are loaded from the pool
+            auto value = (int16_t)((((uint32_t)c * 2654435761u) >> 17) | 0x8001);
+            sum += value;
+            instructions[i++] = Code::Instruction::Push16;
+            instructions[i++] = (Code::Instruction)((unsigned)value & 0xFF);
+            instructions[i++] = (Code::Instruction)((unsigned)value >> 8);
+            if (c > 0) {
+                instructions[i++] = Code::Instruction::Add;
+            }
+        }
+    }
+
+    void preTest(Environment::VM& state)
+    {
+        clearIfNotInCanaryMode(state);
+    }
+
+    bool postTest(Environment::VM& state)
+    {
+        return state.m_stack.size() == 1 + numberOfCanaryValues() && state.m_stack.peek() == sum;
+    }
+
+private:
+    static const int Count = 400;
+    static const size_t Length = 4 * Count - 1 + 4;
+    Code::Instruction instructions[Length];
+    int32_t sum;
+};
+
 class WaitTest : public SingleInstructionTest {
 public:
     WaitTest()
@@ -787,6 +955,56 @@ private:
     bool shouldJump;
 };
 
+/// Like CjmpTest, but the jump skips enough code that it needs the long form of the conditional branch
+class CjmpLongTest : public CodeTest {
+public:
+    CjmpLongTest(bool shouldJump)
+        : CodeTest((const Code::Instruction*)instructions, Length)
+        , shouldJump(shouldJump)
+        , sum(0)
+    {
+        size_t i = 0;
+        instructions[i++] = Code::Instruction::Push16;
+        instructions[i++] = (Code::Instruction)((Length - 2) & 0xFF);
+        instructions[i++] = (Code::Instruction)((Length - 2) >> 8);
+        instructions[i++] = Code::Instruction::Cjmp;
+        instructions[i++] = Code::Instruction::Push8;
+        instructions[i++] = (Code::Instruction)0;
+        for (int c = 0; c < Count; ++c) {
+            auto value = (int16_t)(1000 + 37 * c);
+            sum += value;
+            instructions[i++] = Code::Instruction::Push16;
+            instructions[i++] = (Code::Instruction)((unsigned)value & 0xFF);
+            instructions[i++] = (Code::Instruction)((unsigned)value >> 8);
+            instructions[i++] = Code::Instruction::Add;
+        }
+        instructions[i++] = Code::Instruction::Push8;
+        instructions[i++] = (Code::Instruction)37;
+    }
+
+    void preTest(Environment::VM& state)
+    {
+        clearIfNotInCanaryMode(state);
+        state.m_stack.push(shouldJump ? 1 : 0);
+    }
+
+    bool postTest(Environment::VM& state)
+    {
+        if (shouldJump) {
+            return state.m_stack.size() == 1 + numberOfCanaryValues() && state.m_stack.peek() == 37;
+        } else {
+            return state.m_stack.size() == 2 + numberOfCanaryValues() && state.m_stack.peek(1) == sum && state.m_stack.peek() == 37;
+        }
+    }
+
+private:
+    static const int Count = 100;
+    static const size_t Length = 4 + 2 + 4 * Count + 2;
+    Code::Instruction instructions[Length];
+    bool shouldJump;
+    int32_t sum;
+};
+
 static const Code::Instruction backwardsCjumpInstructions[] = {
     (Code::Instruction)0x18, (Code::Instruction)0x06,
     (Code::Instruction)0x1D,
@@ -817,6 +1035,83 @@ public:
     }
 };
 
+static const Code::Instruction computedJumpInstructions[] = {
+    // 0: Jumps to 8 if the value pushed before the program starts is true
+    Code::Instruction::Push8, (Code::Instruction)8, Code::Instruction::Cjmp,
+    // 3: Jumps to 10 with 11 on the stack
+    Code::Instruction::Push8, (Code::Instruction)11, Code::Instruction::Push8, (Code::Instruction)10, Code::Instruction::Jmp,
+    // 8: Falls through to 10 with 14 on the stack
+    Code::Instruction::Push8, (Code::Instruction)14,
+    // 10: Jumps to the destination on the stack
+    Code::Instruction::Jmp,
+    // 11
+    Code::Instruction::Push8, (Code::Instruction)37,
+    Code::Instruction::Halt,
+    // 14
+    Code::Instruction::Push8, (Code::Instruction)42,
+    Code::Instruction::Halt
+};
+class ComputedJumpTest : public CodeTest {
+public:
+    ComputedJumpTest(bool condition, int expected)
+        : CodeTest(computedJumpInstructions, sizeof(computedJumpInstructions) / sizeof(Code::Instruction))
+        , condition(condition)
+        , expected(expected)
+    {
+    }
+
+    void preTest(Environment::VM& state)
+    {
+        clearIfNotInCanaryMode(state);
+        state.m_stack.push(condition ? 1 : 0);
+    }
+
+    bool postTest(Environment::VM& state)
+    {
+        return state.m_stack.size() == 1 + numberOfCanaryValues() && state.m_stack.peek() == expected;
+    }
+
+private:
+    bool condition;
+    int expected;
+};
+
+/// A table of cases that are each 3 bytes long, so the destination of the jump isn't a constant that the analysis can find
+static const Code::Instruction computedSwitchInstructions[] = {
+    // 0: Jumps to 7 + 3 * the value pushed before the program starts
+    Code::Instruction::Push8, (Code::Instruction)3, Code::Instruction::Mul,
+    Code::Instruction::Push8, (Code::Instruction)7, Code::Instruction::Add,
+    Code::Instruction::Jmp,
+    // 7
+    Code::Instruction::Push8, (Code::Instruction)10, Code::Instruction::Halt,
+    // 10
+    Code::Instruction::Push8, (Code::Instruction)20, Code::Instruction::Halt,
+    // 13
+    Code::Instruction::Push8, (Code::Instruction)30, Code::Instruction::Halt
+};
+class ComputedSwitchTest : public CodeTest {
+public:
+    ComputedSwitchTest(int index)
+        : CodeTest(computedSwitchInstructions, sizeof(computedSwitchInstructions) / sizeof(Code::Instruction))
+        , index(index)
+    {
+    }
+
+    void preTest(Environment::VM& state)
+    {
+        clearIfNotInCanaryMode(state);
+        state.m_stack.push(index);
+    }
+
+    bool postTest(Environment::VM& state)
+    {
+        return state.m_stack.size() == 1 + numberOfCanaryValues() && state.m_stack.peek() == 10 * (index + 1);
+    }
+
+private:
+    int index;
+};
+
 static const Code::Instruction fetchInstructions[] = {
     Code::Instruction::Push8, (Code::Instruction)4,
     Code::Instruction::Fetch,
@@ -1493,6 +1788,44 @@ public:
     }
 };
 
+static const Code::Instruction dynamicDispatchCode[] = {
+    // 0:
+    Code::Instruction::Push8, (Code::Instruction)0,
+    // 2: Calls the same function twice from the same call site
+    Code::Instruction::Push8, (Code::Instruction)25, Code::Instruction::Push8, (Code::Instruction)23, Code::Instruction::Call,
+    // 7:
+    Code::Instruction::Push8, (Code::Instruction)25, Code::Instruction::Push8, (Code::Instruction)23, Code::Instruction::Call,
+    // 12: Then a different function, and back to the first
+    Code::Instruction::Push8, (Code::Instruction)27, Code::Instruction::Push8, (Code::Instruction)23, Code::Instruction::Call,
+    // 17:
+    Code::Instruction::Push8, (Code::Instruction)25, Code::Instruction::Push8, (Code::Instruction)23, Code::Instruction::Call,
+    // 22:
+    Code::Instruction::Halt,
+    // 23: Call the top of stack
+    Code::Instruction::Call, Code::Instruction::Ret,
+    // 25:
+    Code::Instruction::Inc, Code::Instruction::Ret,
+    // 27:
+    Code::Instruction::Push8, (Code::Instruction)10, Code::Instruction::Mul, Code::Instruction::Ret
+};
+class DynamicDispatchTest : public CodeTest {
+public:
+    DynamicDispatchTest()
+        : CodeTest(dynamicDispatchCode, sizeof(dynamicDispatchCode) / sizeof(Code::Instruction))
+    {
+    }
+
+    void preTest(Environment::VM& state)
+    {
+        clearIfNotInCanaryMode(state);
+    }
+
+    bool postTest(Environment::VM& state)
+    {
+        return state.m_stack.size() == 1 + numberOfCanaryValues() && state.m_stack.peek() == 21;
+    }
+};
+
 class MarksEnumTest : public CodeTest {
 public:
     MarksEnumTest()
@@ -1655,6 +1988,121 @@ public:
     }
 };
 
+/// Squares 5 + 1 through a tail call to another function, which is a branch as neither function saves LR
+static const Code::Instruction tailCallTestCode[] = {
+    // 0: push 5, call incrementAndSquare
+    Code::Instruction::Push8, (Code::Instruction)5, Code::Instruction::Push8, (Code::Instruction)6, Code::Instruction::Call,
+    // 5
+    Code::Instruction::Halt,
+    // 6: incrementAndSquare
+    Code::Instruction::Inc,
+    // 7: tail call square
+    Code::Instruction::Push8, (Code::Instruction)11, Code::Instruction::Call,
+    // 10
+    Code::Instruction::Ret,
+    // 11: square
+    Code::Instruction::Dup, Code::Instruction::Mul, Code::Instruction::Ret
+};
+class TailCallTest : public CodeTest {
+public:
+    TailCallTest()
+        : CodeTest(tailCallTestCode, sizeof(tailCallTestCode) / sizeof(tailCallTestCode[0]))
+    {
+    }
+
+    void preTest(Environment::VM& state)
+    {
+        clearIfNotInCanaryMode(state);
+    }
+
+    bool postTest(Environment::VM& state)
+    {
+        return state.m_stack.size() == numberOfCanaryValues() + 1 && state.m_stack.peek() == 36;
+    }
+};
+
+/// Doubles 5 + 1 after calling a function that is interpreted, whose Ret is the last instruction of the code
+static const Code::Instruction interpretedReturnTestCode[] = {
+    // 0: push 5, call increment
+    Code::Instruction::Push8, (Code::Instruction)5, Code::Instruction::Push8, (Code::Instruction)9, Code::Instruction::Call,
+    // 5: push 2, mul
+    Code::Instruction::Push8, (Code::Instruction)2, Code::Instruction::Mul,
+    // 8
+    Code::Instruction::Halt,
+    // 9: increment
+    Code::Instruction::Inc, Code::Instruction::Ret
+};
+class InterpretedReturnTest : public CodeTest {
+public:
+    InterpretedReturnTest()
+        : CodeTest(interpretedReturnTestCode, sizeof(interpretedReturnTestCode) / sizeof(interpretedReturnTestCode[0]))
+    {
+    }
+
+    void preTest(Environment::VM& state)
+    {
+        clearIfNotInCanaryMode(state);
+    }
+
+    void configureCompiler(JIT::Compiler& compiler)
+    {
+        compiler.interpretFunction(9);
+    }
+
+    bool postTest(Environment::VM& state)
+    {
+        return state.m_stack.size() == numberOfCanaryValues() + 1 && state.m_stack.peek() == 12;
+    }
+};
+
+/// Sums 10 + 9 + ... + 1 with the accumulator and counter on the stack, so both are carried around the loop
+static const Code::Instruction loopCarriedValuesCode[] = {
+    // 0: push 0 (accumulator)
+    Code::Instruction::Push8, (Code::Instruction)0,
+    // 2: push 10 (counter)
+    Code::Instruction::Push8, (Code::Instruction)10,
+    // 4: loop: dup
+    Code::Instruction::Dup,
+    // 5: push 0
+    Code::Instruction::Push8, (Code::Instruction)0,
+    // 7
+    Code::Instruction::Eq,
+    // 8: push end
+    Code::Instruction::Push8, (Code::Instruction)19,
+    // 10
+    Code::Instruction::Cjmp,
+    // 11: accumulator counter -> (accumulator + counter) (counter - 1)
+    Code::Instruction::Dup,
+    Code::Instruction::Rot,
+    Code::Instruction::Add,
+    Code::Instruction::Swap,
+    Code::Instruction::Dec,
+    // 16: push loop
+    Code::Instruction::Push8, (Code::Instruction)4,
+    // 18
+    Code::Instruction::Jmp,
+    // 19: end
+    Code::Instruction::Drop,
+    Code::Instruction::Ret
+};
+class LoopCarriedValuesTest : public CodeTest {
+public:
+    LoopCarriedValuesTest()
+        : CodeTest(loopCarriedValuesCode, sizeof(loopCarriedValuesCode) / sizeof(loopCarriedValuesCode[0]))
+    {
+    }
+
+    void preTest(Environment::VM& state)
+    {
+        clearIfNotInCanaryMode(state);
+    }
+
+    bool postTest(Environment::VM& state)
+    {
+        return state.m_stack.size() == 1 + numberOfCanaryValues() && state.m_stack.peek() == 55;
+    }
+};
+
 /// Used for verifying weird behaviour in the COW allocator
 static const Code::Instruction rotArithmetic[] = {
     Code::Instruction::Dup,
@@ -1804,6 +2252,43 @@ bool testCodeExecution()
     success &= OP_TEST("DivPushTest", SingleOperatorPushTest(Code::Instruction::Div, 42, 2, 21));
     success &= OP_TEST("ModTest", SingleOperatorTest(Code::Instruction::Mod, 50, 7, 1));
     success &= OP_TEST("ModPushTest", SingleOperatorPushTest(Code::Instruction::Mod, 50, 7, 1));
+    success &= OP_TEST("DivPreservedOperandTest", PreservedOperandTest(Code::Instruction::Div, 7, 100, 21));
+    success &= OP_TEST("ModPreservedOperandTest", PreservedOperandTest(Code::Instruction::Mod, 7, 100, 9));
+    success &= OP_TEST("DivNegativeTest", SingleOperatorTest(Code::Instruction::Div, -7, 2, -3));
+    success &= OP_TEST("ModNegativeTest", SingleOperatorTest(Code::Instruction::Mod, -7, 2, -1));
+    success &= OP_TEST("DivByZeroTest", SingleOperatorTest(Code::Instruction::Div, 7, 0, 0));
+    success &= OP_TEST("DivByZeroPushTest", SingleOperatorPushTest(Code::Instruction::Div, 7, 0, 0));
+    success &= OP_TEST("ModByZeroTest", SingleOperatorTest(Code::Instruction::Mod, 7, 0, 7));
+    success &= OP_TEST("ModByZeroPushTest", SingleOperatorPushTest(Code::Instruction::Mod, 7, 0, 7));
+    success &= OP_TEST("DivWrapTest", SingleOperatorTest(Code::Instruction::Div, INT32_MIN, -1, INT32_MIN));
+    success &= OP_TEST("ModWrapTest", SingleOperatorTest(Code::Instruction::Mod, INT32_MIN, -1, 0));
+    success &= OP_TEST("DivLargeQuotientTest", SingleOperatorTest(Code::Instruction::Div, 2000000000, -3, -666666666));
+
+    // Strength reduction of known operands
+    success &= OP_TEST("MulConstantPowerTest", ConstantOperandTest(Code::Instruction::Mul, -3, 8, -24));
+    success &= OP_TEST("MulConstantNegativePowerTest", ConstantOperandTest(Code::Instruction::Mul, 5, -8, -40));
+    success &= OP_TEST("MulConstantPowerPlusOneTest", ConstantOperandTest(Code::Instruction::Mul, 5, 9, 45));
+    success &= OP_TEST("MulConstantPowerMinusOneTest", ConstantOperandTest(Code::Instruction::Mul, 5, 7, 35));
+    success &= OP_TEST("MulConstantTwoBitsTest", ConstantOperandTest(Code::Instruction::Mul, 7, 10, 70));
+    success &= OP_TEST("MulConstantOtherTest", ConstantOperandTest(Code::Instruction::Mul, 7, 11, 77));
+    success &= OP_TEST("MulConstantZeroTest", ConstantOperandTest(Code::Instruction::Mul, 7, 0, 0));
+    success &= OP_TEST("MulConstantMinusOneTest", ConstantOperandTest(Code::Instruction::Mul, 7, -1, -7));
+    success &= OP_TEST("DivConstantPowerTest", ConstantOperandTest(Code::Instruction::Div, -7, 2, -3));
+    success &= OP_TEST("DivConstantLargePowerTest", ConstantOperandTest(Code::Instruction::Div, -100, 64, -1));
+    success &= OP_TEST("DivConstantNegativePowerTest", ConstantOperandTest(Code::Instruction::Div, -8, -4, 2));
+    success &= OP_TEST("DivConstantTest", ConstantOperandTest(Code::Instruction::Div, -101, 10, -10));
+    success &= OP_TEST("DivConstantNegativeTest", ConstantOperandTest(Code::Instruction::Div, 101, -10, -10));
+    success &= OP_TEST("DivConstantLargeTest", ConstantOperandTest(Code::Instruction::Div, INT32_MIN, 7, -306783378));
+    success &= OP_TEST("DivConstantOneTest", ConstantOperandTest(Code::Instruction::Div, 42, 1, 42));
+    success &= OP_TEST("DivConstantMinusOneTest", ConstantOperandTest(Code::Instruction::Div, INT32_MIN, -1, INT32_MIN));
+    success &= OP_TEST("DivConstantZeroTest", ConstantOperandTest(Code::Instruction::Div, 7, 0, 0));
+    success &= OP_TEST("ModConstantPowerTest", ConstantOperandTest(Code::Instruction::Mod, -7, 4, -3));
+    success &= OP_TEST("ModConstantNegativePowerTest", ConstantOperandTest(Code::Instruction::Mod, 7, -4, 3));
+    success &= OP_TEST("ModConstantTest", ConstantOperandTest(Code::Instruction::Mod, -101, 10, -1));
+    success &= OP_TEST("ModConstantNegativeTest", ConstantOperandTest(Code::Instruction::Mod, 101, -10, 1));
+    success &= OP_TEST("ModConstantLargeTest", ConstantOperandTest(Code::Instruction::Mod, INT32_MIN, 3, -2));
+    success &= OP_TEST("ModConstantOneTest", ConstantOperandTest(Code::Instruction::Mod, 42, 1, 0));
+    success &= OP_TEST("ModConstantZeroTest", ConstantOperandTest(Code::Instruction::Mod, 7, 0, 7));
 
     success &= CANARY_OP_TEST("AdditionTest", SingleOperatorTest(Code::Instruction::Add, 1, 42, 43));
     success &= CANARY_OP_TEST("AdditionTestPush", SingleOperatorPushTest(Code::Instruction::Add, 1, 42, 43));
@@ -1818,6 +2303,8 @@ bool testCodeExecution()
     success &= CANARY_OP_TEST("DivPushTest", SingleOperatorPushTest(Code::Instruction::Div, 42, 2, 21));
     success &= CANARY_OP_TEST("ModTest", SingleOperatorTest(Code::Instruction::Mod, 50, 7, 1));
     success &= CANARY_OP_TEST("ModPushTest", SingleOperatorPushTest(Code::Instruction::Mod, 50, 7, 1));
+    success &= CANARY_OP_TEST("DivPreservedOperandTest", PreservedOperandTest(Code::Instruction::Div, 7, 100, 21));
+    success &= CANARY_OP_TEST("ModPreservedOperandTest", PreservedOperandTest(Code::Instruction::Mod, 7, 100, 9));
 
     success &= OP_TEST("IncTest", SingleOperatorTest(Code::Instruction::Inc, 42, 43));
     success &= OP_TEST("DecTest", SingleOperatorTest(Code::Instruction::Dec, 42, 41));
@@ -1930,6 +2417,8 @@ bool testCodeExecution()
 
     success &= CODE_TEST(Push8ManyTest);
     success &= CANARY_CODE_TEST(Push8ManyTest);
+    success &= CODE_TEST(ManyLargeConstantsTest);
+    success &= CANARY_CODE_TEST(ManyLargeConstantsTest);
 
     success &= OP_TEST("Push16Test(-1)", Push16Test(-1));
     success &= OP_TEST("Push16Test(0)", Push16Test(0));
@@ -1945,19 +2434,46 @@ bool testCodeExecution()
     success &= CANARY_OP_TEST("Push16Test(32767)", Push16Test(32767)); // 2^15 - 1
     success &= CANARY_OP_TEST("Push16Test(-32768)", Push16Test(-32768));
 
+    success &= OP_TEST("Push16Test(4660)", Push16Test(4660)); // 0x1234
+    success &= OP_TEST("Push16Test(-300)", Push16Test(-300));
+    success &= OP_TEST("Push16Test(32512)", Push16Test(32512)); // 0x7F00
+    success &= OP_TEST("Push16Test(-32767)", Push16Test(-32767));
+    success &= OP_TEST("NearbyConstantsTest(1000, 1003)", NearbyConstantsTest(1000, 1003));
+    success &= OP_TEST("NearbyConstantsTest(-1000, -800)", NearbyConstantsTest(-1000, -800));
+    success &= OP_TEST("NearbyConstantsTest(4660, 4660)", NearbyConstantsTest(4660, 4660));
+
     success &= CODE_TEST(WaitTest);
     success &= CANARY_CODE_TEST(WaitTest);
 
     success &= CODE_TEST(JumpTest);
     success &= OP_TEST("CjmpTest(false)", CjmpTest(false));
     success &= OP_TEST("CjmpTest(true)", CjmpTest(true));
+    success &= OP_TEST("CjmpLongTest(false)", CjmpLongTest(false));
+    success &= OP_TEST("CjmpLongTest(true)", CjmpLongTest(true));
     success &= CODE_TEST(CjmpBackwardsTest);
 
     success &= CANARY_CODE_TEST(JumpTest);
     success &= CANARY_OP_TEST("CjmpTest(false)", CjmpTest(false));
     success &= CANARY_OP_TEST("CjmpTest(true)", CjmpTest(true));
+    success &= CANARY_OP_TEST("CjmpLongTest(false)", CjmpLongTest(false));
+    success &= CANARY_OP_TEST("CjmpLongTest(true)", CjmpLongTest(true));
     success &= CANARY_CODE_TEST(CjmpBackwardsTest);
 
+    if (ComputedJumps) {
+        success &= OP_TEST("ComputedJumpTest(false)", ComputedJumpTest(false, 37));
+        success &= OP_TEST("ComputedJumpTest(true)", ComputedJumpTest(true, 42));
+        success &= CANARY_OP_TEST("ComputedJumpTest(false)", ComputedJumpTest(false, 37));
+        success &= CANARY_OP_TEST("ComputedJumpTest(true)", ComputedJumpTest(true, 42));
+    }
+
+    // A function with a jump to a destination that the analysis can't find is interpreted
+    if (ComputedJumps && InterpreterFallback) {
+        success &= OP_TEST("ComputedSwitchTest(0)", ComputedSwitchTest(0));
+        success &= OP_TEST("ComputedSwitchTest(2)", ComputedSwitchTest(2));
+        success &= CANARY_OP_TEST("ComputedSwitchTest(0)", ComputedSwitchTest(0));
+        success &= CANARY_OP_TEST("ComputedSwitchTest(2)", ComputedSwitchTest(2));
+    }
+
     success &= OP_TEST("EqCjmpTest1", ConditionalCodeTest(37, 42, Code::Instruction::Eq, false));
     success &= OP_TEST("EqCjmpTest2", ConditionalCodeTest(37, 37, Code::Instruction::Eq, true));
 
@@ -2011,6 +2527,11 @@ bool testCodeExecution()
     success &= CODE_TEST(JumpToNonRecFunctionTest);
     success &= CODE_TEST(GCDTest);
     success &= CODE_TEST(TailRecTest);
+    success &= CODE_TEST(TailCallTest);
+    if (InterpreterFallback) {
+        success &= CODE_TEST(InterpretedReturnTest);
+    }
+    success &= CODE_TEST(LoopCarriedValuesTest);
 
     success &= CANARY_CODE_TEST(FunctionTest);
     success &= CANARY_CODE_TEST(BoundedRecursionTest);
@@ -2024,12 +2545,19 @@ bool testCodeExecution()
     success &= CANARY_CODE_TEST(JumpToNonRecFunctionTest);
     success &= CANARY_CODE_TEST(GCDTest);
     success &= CANARY_CODE_TEST(TailRecTest);
+    success &= CANARY_CODE_TEST(TailCallTest);
+    if (InterpreterFallback) {
+        success &= CANARY_CODE_TEST(InterpretedReturnTest);
+    }
+    success &= CANARY_CODE_TEST(LoopCarriedValuesTest);
 
     success &= CODE_TEST(DynamicCallTest);
     success &= CODE_TEST(DynamicCall2Test);
+    success &= CODE_TEST(DynamicDispatchTest);
 
     success &= CANARY_CODE_TEST(DynamicCallTest);
     success &= CANARY_CODE_TEST(DynamicCall2Test);
+    success &= CANARY_CODE_TEST(DynamicDispatchTest);
 
     success &= CODE_TEST(MarksEnumTest);
     success &= CODE_TEST(MarksLoopExitTest);
@@ -32,6 +32,173 @@ bool testSingleOptionalInstruction()
     return result;
 }
 
+static const Code::Instruction functionStackEffectCode[] = {
+    // 0: Call 6(3)
+    Code::Instruction::Push8, (Code::Instruction)3, Code::Instruction::Push8, (Code::Instruction)6, Code::Instruction::Call,
+    // 5
+    Code::Instruction::Halt,
+    // 6: Pops 1, pushes 2
+    Code::Instruction::Dup, Code::Instruction::Dup, Code::Instruction::Add, Code::Instruction::Add, Code::Instruction::Ret
+};
+bool testFunctionStackEffect()
+{
+    Code::Array code(functionStackEffectCode, sizeof(functionStackEffectCode) / sizeof(Code::Instruction));
+    StaticAnalysis analysis(code);
+
+    if (analysis.analyse() != StaticAnalysis::Status::Success) {
+        analysis.printStaticAnalyis();
+        return false;
+    }
+
+    auto callee = analysis.stackEffectForFunction(6);
+    auto caller = analysis.stackEffectForFunction(0);
+    return callee.bounded() && callee.popCount() == 1 && callee.pushCount() == 2 && callee.heightDifference() == 0 && caller.bounded() && caller.popCount() == 0 && caller.pushCount() == 3;
+}
+
+static const Code::Instruction recursiveStackEffectCode[] = {
+    // 0: Call 0
+    Code::Instruction::Push8, (Code::Instruction)0, Code::Instruction::Call,
+    // 3
+    Code::Instruction::Ret
+};
+bool testRecursiveFunctionStackEffect()
+{
+    Code::Array code(recursiveStackEffectCode, sizeof(recursiveStackEffectCode) / sizeof(Code::Instruction));
+    StaticAnalysis analysis(code);
+
+    if (analysis.analyse() != StaticAnalysis::Status::Success) {
+        analysis.printStaticAnalyis();
+        return false;
+    }
+
+    return !analysis.stackEffectForFunction(0).bounded();
+}
+
+static const Code::Instruction computedJumpCode[] = {
+    // 0: Jumps to 9 if the stack isn't empty
+    Code::Instruction::Size, Code::Instruction::Push8, (Code::Instruction)9, Code::Instruction::Cjmp,
+    // 4: Jumps to 11 with 15 on the stack
+    Code::Instruction::Push8, (Code::Instruction)15, Code::Instruction::Push8, (Code::Instruction)11, Code::Instruction::Jmp,
+    // 9: Falls through to 11 with 12 on the stack
+    Code::Instruction::Push8, (Code::Instruction)12,
+    // 11: Jumps to 12 or 15, but not to 1 or 3 as they are pushed but never reach the jump
+    Code::Instruction::Jmp,
+    // 12
+    Code::Instruction::Push8, (Code::Instruction)1, Code::Instruction::Halt,
+    // 15
+    Code::Instruction::Push8, (Code::Instruction)3, Code::Instruction::Halt
+};
+bool testComputedJumpTargets()
+{
+    Code::Array code(computedJumpCode, sizeof(computedJumpCode) / sizeof(Code::Instruction));
+    StaticAnalysis analysis(code);
+
+    if (analysis.analyse() != StaticAnalysis::Status::Success) {
+        analysis.printStaticAnalyis();
+        return false;
+    }
+
+    return analysis.hasComputedJumps() && !analysis.hasUnprovenComputedJumps(0) && analysis.isComputedJumpTarget(12) && analysis.isJumpDestination(12) && analysis.isComputedJumpTarget(15) && analysis.isJumpDestination(15) && !analysis.isComputedJumpTarget(1) && !analysis.isComputedJumpTarget(3);
+}
+
+static const Code::Instruction incrementalAnalysisCode[] = {
+    // 0: Call 6(8)
+    Code::Instruction::Push8, (Code::Instruction)8, Code::Instruction::Push8, (Code::Instruction)6, Code::Instruction::Call,
+    // 5
+    Code::Instruction::Halt,
+    // 6: Only found once it is called
+    Code::Instruction::Call, Code::Instruction::Ret,
+    // 8
+    Code::Instruction::Inc, Code::Instruction::Ret
+};
+bool testIncrementalAnalysis()
+{
+    Code::Array code(incrementalAnalysisCode, sizeof(incrementalAnalysisCode) / sizeof(Code::Instruction));
+    StaticAnalysis analysis(code);
+
+    // Each function is found by a separate analysis, after a function that follows it
+    if (analysis.analyse(6) != StaticAnalysis::Status::Success || analysis.analyse(0) != StaticAnalysis::Status::Success) {
+        analysis.printStaticAnalyis();
+        return false;
+    }
+    auto& functions = analysis.functionRegions();
+    if (functions.size() != 2 || functions[0].start() != 0 || functions[1].start() != 6 || analysis.newFunctionRegions().size() != 1 || analysis.codeRegion().end() != 8) {
+        analysis.printStaticAnalyis();
+        return false;
+    }
+
+    if (analysis.analyse(8) != StaticAnalysis::Status::Success) {
+        analysis.printStaticAnalyis();
+        return false;
+    }
+    return functions.size() == 3 && functions[2].start() == 8 && analysis.newFunctionRegions().size() == 1 && analysis.codeRegion().start() == 0 && analysis.codeRegion().end() == 10;
+}
+
+static const Code::Instruction basicBlockTableCode[] = {
+    // 0
+    Code::Instruction::Push8, (Code::Instruction)3,
+    // 2: Loops until the top of the stack is zero
+    Code::Instruction::Dec, Code::Instruction::Dup, Code::Instruction::Push8, (Code::Instruction)2, Code::Instruction::Cjmp,
+    // 7
+    Code::Instruction::Ret
+};
+bool testBasicBlockTable()
+{
+    Code::Array code(basicBlockTableCode, sizeof(basicBlockTableCode) / sizeof(Code::Instruction));
+    StaticAnalysis analysis(code);
+
+    if (analysis.analyse() != StaticAnalysis::Status::Success) {
+        analysis.printStaticAnalyis();
+        return false;
+    }
+
+    size_t count = 0;
+    auto blocks = analysis.blocksForFunction(0, count);
+    if (!blocks || count != 3) {
+        analysis.printStaticAnalyis();
+        return false;
+    }
+    auto& table = analysis.basicBlockTable();
+    auto entry = analysis.blockIndex(0), loop = analysis.blockIndex(2), loopExit = analysis.blockIndex(7);
+    return table[entry].region() == Code::Region(0, 2) && table[entry].m_effect.heightDifference() == -1 && table[entry].m_jumpSuccessor == BasicBlockSummary::NoBlock && table[entry].m_fallThroughSuccessor == loop
+        && table[loop].region() == Code::Region(2, 5) && table[loop].m_jumpSuccessor == loop && table[loop].m_fallThroughSuccessor == loopExit
+        && table[loopExit].m_jumpSuccessor == BasicBlockSummary::NoBlock && table[loopExit].m_fallThroughSuccessor == BasicBlockSummary::NoBlock && table[loopExit].m_function == 0;
+}
+
+static const Code::Instruction linkRegisterCode[] = {
+    // 0: Calls 10, 16, and 24
+    Code::Instruction::Push8, (Code::Instruction)10, Code::Instruction::Call,
+    Code::Instruction::Push8, (Code::Instruction)16, Code::Instruction::Call,
+    Code::Instruction::Push8, (Code::Instruction)24, Code::Instruction::Call,
+    // 9
+    Code::Instruction::Halt,
+    // 10: Tail calls a leaf function
+    Code::Instruction::Push8, (Code::Instruction)14, Code::Instruction::Call, Code::Instruction::Ret,
+    // 14: Leaf function
+    Code::Instruction::Swap, Code::Instruction::Ret,
+    // 16: Mutually tail recursive with 20
+    Code::Instruction::Push8, (Code::Instruction)20, Code::Instruction::Call, Code::Instruction::Ret,
+    // 20
+    Code::Instruction::Push8, (Code::Instruction)16, Code::Instruction::Call, Code::Instruction::Ret,
+    // 24: Mutually tail recursive with 28, which calls a helper
+    Code::Instruction::Push8, (Code::Instruction)28, Code::Instruction::Call, Code::Instruction::Ret,
+    // 28
+    Code::Instruction::Nrnd, Code::Instruction::Push8, (Code::Instruction)24, Code::Instruction::Call, Code::Instruction::Ret
+};
+bool testLinkRegisterSaving()
+{
+    Code::Array code(linkRegisterCode, sizeof(linkRegisterCode) / sizeof(Code::Instruction));
+    StaticAnalysis analysis(code);
+    analysis.setStackCheckMode(StackCheck::BoundsCheckInPlace);
+
+    if (analysis.analyse() != StaticAnalysis::Status::Success) {
+        analysis.printStaticAnalyis();
+        return false;
+    }
+
+    return analysis.functionNeedsToPushRegisters(0) && !analysis.functionNeedsToPushRegisters(10) && !analysis.functionNeedsToPushRegisters(14) && !analysis.functionNeedsToPushRegisters(16) && !analysis.functionNeedsToPushRegisters(20) && analysis.functionNeedsToPushRegisters(24) && analysis.functionNeedsToPushRegisters(28);
+}
+
 bool testStaticAnalysis()
 {
     printTestHeader("STATIC ANALYSIS TESTS");
@@ -40,6 +207,16 @@ bool testStaticAnalysis()
 
     success &= TEST(testEmptyStaticAnalysis);
     success &= TEST(testSingleOptionalInstruction);
+    success &= TEST(testFunctionStackEffect);
+    success &= TEST(testRecursiveFunctionStackEffect);
+    success &= TEST(testIncrementalAnalysis);
+    success &= TEST(testBasicBlockTable);
+    if (TailCallsOptimised) {
+        success &= TEST(testLinkRegisterSaving);
+    }
+    if (ComputedJumps) {
+        success &= TEST(testComputedJumpTargets);
+    }
 
     return success;
 }
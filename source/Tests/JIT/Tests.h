@@ -7,4 +7,7 @@ namespace JIT {
 bool testCodeExecution();
 bool testCompiler();
 bool testStaticAnalysis();
+
+/// Compares the code size and speed of the copy-on-write and scheduling register allocators
+void benchmarkRegisterAllocators();
 }
\ No newline at end of file
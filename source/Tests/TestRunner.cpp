@@ -28,6 +28,10 @@ void unitTests()
     }
     success &= JIT::testCodeExecution();
 
+    if (ProfilingEnabled) {
+        JIT::benchmarkRegisterAllocators();
+    }
+
     printTestStats();
 
     if (success) {
@@ -45,16 +45,28 @@ void printConfiguration()
     BOOL_PRINT(AlwaysPrintStaticAnalysis);
     INT_PRINT(BrightnessFactor);
     BOOL_PRINT(BoundsCheckElimination);
+    BOOL_PRINT(BranchRelaxation);
     BOOL_PRINT(CompileOptionalInstructionTests);
+    INT_PRINT(CompilerMemoryBudget);
+    BOOL_PRINT(ComputedJumps);
     ENUM_PRINT(ConditionalBranchingMode, ConditionalBranchType_Strings);
     BOOL_PRINT(EnsureZeroesAfterStack);
+    BOOL_PRINT(FunctionLevelBoundsChecks);
+    BOOL_PRINT(FunctionLevelRegisterAllocation);
+    BOOL_PRINT(InlineCaching);
+    BOOL_PRINT(InterpreterFallback);
     ENUM_PRINT(Mode, ProjectMode_Strings);
     BOOL_PRINT(ProfilingEnabled);
     ENUM_PRINT(RegisterAllocationMode, RegisterAllocation_Strings);
+    BOOL_PRINT(RegisterPreservingHelpers);
     BOOL_PRINT(RegisterWriteElimination);
     ENUM_PRINT(StackCheckMode, StackCheck_Strings);
+    BOOL_PRINT(StrengthReduction);
     BOOL_PRINT(TailCallsOptimised);
     INT_PRINT(TestExecutionCount);
+    BOOL_PRINT(TieredCompilation);
+    INT_PRINT(TieredCompilationThreshold);
+    BOOL_PRINT(WholeProgramStackBounds);
 }
 
 void incSuccess()
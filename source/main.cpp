@@ -4,6 +4,7 @@
 #include "Device/OptionalInstructions.h"
 #include "JIT/Compiler.h"
 #include "JIT/Interpreter.h"
+#include "JIT/TieredExecution.h"
 #include "MicroBit.h"
 #include "MicroBitFileSystem.h"
 #include "Tests/TestRunner.h"
@@ -36,23 +37,35 @@ void readAndExecuteProgram()
     JIT::Compiler compiler(state.m_code, &Device::MicroBitDevice::singleton());
     state.m_compiler = &compiler;
 
-    compiler.addObserver([&](ARM::Functor& func, Status status) {
-        if (status == Status::Success && WriteCompiledCodeToFlash) {
-            func.serialise();
-            compiler.serialise();
-        }
-    });
-
-    auto result = compiler.compile(func);
-
-    if (result == JIT::Compiler::Status::Success) {
-        state.call(func);
-        // Ensure sounder and LEDs are off after execution
+    if (TieredCompilation) {
+        // Only some of the program is ever compiled, so there is nothing to write to flash
+        JIT::TieredExecution tieredExecution(compiler, func);
+        state.m_tieredExecution = &tieredExecution;
+        JIT::execute(&state);
         state.m_stack.print();
     } else {
-        printf("Compilation error: %s\n", JIT::Compiler::statusString(result));
+        compiler.addObserver([&](ARM::Functor& func, Status status) {
+            if (status == Status::Success && WriteCompiledCodeToFlash) {
+                if (func.serialise()) {
+                    compiler.serialise();
+                }
+            }
+        });
+
+        auto result = compiler.compile(func);
+
+        if (result == JIT::Compiler::Status::Success) {
+            if (WholeProgramStackBounds && compiler.provenMaximumStackDepth() >= 0) {
+                printf("Proven maximum stack depth: %d\n", compiler.provenMaximumStackDepth());
+            }
+            state.call(func);
+            state.m_stack.print();
+        } else {
+            printf("Compilation error: %s\n", JIT::Compiler::statusString(result));
+        }
     }
 
+    // Ensure sounder and LEDs are off after execution
     Device::MicroBitDevice::singleton().programHalted();
 }
 
@@ -78,14 +91,16 @@ void tryRunFromFlash()
     compiler.addObserver([&](ARM::Functor& func, Status status) {
         if (status == Status::Success && WriteCompiledCodeToFlash) {
             Transfer::microBitFileSystem()->remove("");
-            func.serialise();
-            compiler.serialise();
+            if (func.serialise()) {
+                compiler.serialise();
+            }
         }
     });
 
     if (WriteCompiledCodeToFlash) {
         func.deserialise();
         compiler.deserialise();
+        compiler.attachJumpTable(func);
         state.call(func);
     } else {
         auto res = compiler.compile(func);